@@ -297,7 +297,7 @@ int __wasilibc_register_preopened_fd(int fd, const char *prefix); /*{
 int openWriteRead()
 {
     printf("OpenWriteRead\n");
-    __wasilibc_register_preopened_fd(4, "/tmp/")    ;
+    __wasilibc_register_preopened_fd(3, "/tmp/")    ;
     FILE *f = fopen("/tmp/test.txt", "w+");
     if (f == NULL)
         return 1;
@@ -622,7 +622,7 @@ int testTestWrap(){
 
 int GoTest2()
 {
-   __wasilibc_register_preopened_fd(4, "/tmp");
+   __wasilibc_register_preopened_fd(3, "/tmp");
    //__wasilibc_register_preopened_fd(5, "/tmp/sqlthing");
     /*
     helloWorld();
@@ -1,3 +1,7 @@
+using System.Runtime.CompilerServices;
+using Mono.Cecil;
+using Mono.Cecil.Cil;
+
 namespace Wasm2Il
 {
 
@@ -105,5 +109,524 @@ namespace Wasm2Il
                 Assert.AreEqual(v, reader.ReadStrN());
         }
 
+
+        public static void TestFdTable()
+        {
+            var table = new FdTable();
+            table.Insert(0, new FdEntry());
+            table.Insert(4, new FdEntry {FileType = Wasi.__wasi_filetype_t.Directory});
+            Assert.IsTrue(table[4]!.IsDirectory);
+            Assert.AreEqual(null, table[3]);
+
+            // skipped slots are handed out before new ones.
+            var fds = new HashSet<int>();
+            for (int i = 0; i < 5000; i++)
+                fds.Add(table.Allocate(new FdEntry()));
+            Assert.AreEqual(5000, fds.Count);
+            Assert.IsTrue(fds.Contains(1) && fds.Contains(3) && !fds.Contains(4));
+
+            Assert.IsTrue(table.Remove(3) != null);
+            Assert.AreEqual(null, table.Remove(3));
+            Assert.AreEqual(3, table.Allocate(new FdEntry()));
+
+            Assert.IsTrue(table.Renumber(4, 1));
+            Assert.AreEqual(null, table[4]);
+            Assert.IsTrue(table[1]!.IsDirectory);
+            Assert.AreEqual(5001, table.Count);
+        }
+
+        public static void TestMemoryFileSystem()
+        {
+            var fs = new MemoryFileSystem();
+            Assert.AreEqual("/a/c", fs.Combine("/a/b", "../c/./"));
+            Assert.AreEqual(Wasi.Error.Success, fs.CreateDirectory("/a"));
+            Assert.AreEqual(Wasi.Error.NoEnt, fs.Open("/a/x", 0, FileAccess.ReadWrite, out _));
+            Assert.AreEqual(Wasi.Error.Success, fs.Open("/a/x", Wasi.OFlags.CREAT, FileAccess.ReadWrite, out var str));
+
+            // write across several pages, then read it back through a second stream.
+            var data = new byte[MemoryFileSystem.PageSize * 3 + 17];
+            new Random(1).NextBytes(data);
+            str!.Seek(5, SeekOrigin.Begin);
+            str.Write(data);
+            Assert.AreEqual((long) data.Length + 5, str.Length);
+            fs.Open("/a/x", 0, FileAccess.Read, out var str2);
+            var read = new byte[data.Length + 5];
+            Assert.AreEqual(read.Length, str2!.Read(read));
+            Assert.IsTrue(read.AsSpan(5).SequenceEqual(data));
+            Assert.IsTrue(read.AsSpan(0, 5).SequenceEqual(new byte[5]));
+
+            // shrinking and growing again must not resurrect old data.
+            str.SetLength(10);
+            str.SetLength(20);
+            str2.Position = 0;
+            Assert.AreEqual(20, str2.Read(read));
+            Assert.IsTrue(read.AsSpan(10, 10).SequenceEqual(new byte[10]));
+
+            Assert.AreEqual(Wasi.Error.Notempty, fs.RemoveDirectory("/a"));
+            Assert.AreEqual(Wasi.Error.Success, fs.Unlink("/a/x"));
+            Assert.AreEqual(Wasi.Error.Success, fs.RemoveDirectory("/a"));
+            Assert.AreEqual(Wasi.__wasi_filetype_t.Unknown, fs.GetFileType("/a"));
+        }
+
+        public static void TestHostFileSystem()
+        {
+            var fs = HostFileSystem.Instance;
+            var dir = Path.Combine(Path.GetTempPath(), Path.GetRandomFileName());
+            Directory.CreateDirectory(dir);
+            try
+            {
+                var path = fs.Combine(dir, "x");
+                // read-only opens that create or truncate, like O_RDONLY|O_CREAT|O_EXCL.
+                Assert.AreEqual(Wasi.Error.Success,
+                    fs.Open(path, Wasi.OFlags.CREAT | Wasi.OFlags.EXCL, FileAccess.Read, out var str));
+                Assert.IsTrue(str!.CanRead && !str.CanWrite);
+                str.Dispose();
+                Assert.AreEqual(Wasi.Error.Exist,
+                    fs.Open(path, Wasi.OFlags.CREAT | Wasi.OFlags.EXCL, FileAccess.Read, out _));
+
+                File.WriteAllText(path, "data");
+                Assert.AreEqual(Wasi.Error.Success, fs.Open(path, Wasi.OFlags.TRUNC, FileAccess.Read, out str));
+                Assert.AreEqual(0L, str!.Length);
+                str.Dispose();
+                Assert.AreEqual(Wasi.Error.Success,
+                    fs.Open(path, Wasi.OFlags.CREAT | Wasi.OFlags.TRUNC, FileAccess.Read, out str));
+                str!.Dispose();
+                Assert.AreEqual(Wasi.Error.NoEnt,
+                    fs.Open(fs.Combine(dir, "y"), Wasi.OFlags.TRUNC, FileAccess.Read, out _));
+            }
+            finally
+            {
+                Directory.Delete(dir, true);
+            }
+        }
+
+        public static void TestWasiRandom()
+        {
+            var a = new byte[300];
+            var b = new byte[300];
+            new WasiRandom(42).Fill(a);
+            new WasiRandom(42).Fill(b);
+            Assert.IsTrue(a.AsSpan().SequenceEqual(b));
+
+            // pooled small requests must not repeat bytes.
+            var rnd = new WasiRandom();
+            var small1 = new byte[16];
+            var small2 = new byte[16];
+            rnd.Fill(small1);
+            rnd.Fill(small2);
+            Assert.IsTrue(!small1.AsSpan().SequenceEqual(small2));
+        }
+
+        public static void TestGuestMemory()
+        {
+            var memory = new byte[64];
+            new GuestPtr<int>(8).Deref(memory) = 0x01020304;
+            Assert.AreEqual(4, memory[8]);
+            Assert.AreEqual(0x01020304, new GuestSpan<int>(0, 4).Get(memory)[2]);
+            var failed = false;
+            try
+            {
+                new GuestPtr<long>(60).Deref(memory);
+            }
+            catch (ArgumentOutOfRangeException)
+            {
+                failed = true;
+            }
+            Assert.IsTrue(failed);
+
+            var cache = new Utf8StringCache();
+            var a = cache.Get(System.Text.Encoding.UTF8.GetBytes("some/path"));
+            Assert.AreEqual("some/path", a);
+            Assert.IsTrue(ReferenceEquals(a, cache.Get(System.Text.Encoding.UTF8.GetBytes("some/path"))));
+        }
+
+        class PollModule
+        {
+            static byte[] Memory = new byte[256];
+
+            public static byte[] Get() => Memory;
+        }
+
+        public static void TestPoll()
+        {
+            var context = new Wasi.Context(typeof(PollModule).TypeHandle);
+            var memory = PollModule.Get();
+            // one relative clock subscription that has already expired.
+            memory[8] = WasiPoll.EventClock;
+            Assert.AreEqual(Wasi.Error.Success, context.Poll.PollOneoff(context, 0, 64, 1, out var events));
+            Assert.AreEqual(1, events);
+            Assert.AreEqual(WasiPoll.EventClock, memory[64 + 10]);
+
+            // the event array straddles the end of memory.
+            Assert.AreEqual(Wasi.Error.Fault, context.Poll.PollOneoff(context, 0, 240, 1, out events));
+            Assert.AreEqual(Wasi.Error.Fault, context.Poll.PollOneoff(context, 220, 64, 1, out events));
+            Assert.AreEqual(Wasi.Error.Fault, context.Poll.PollOneoff(context, -16, 64, 1, out events));
+            Assert.AreEqual(Wasi.Error.Inval, context.Poll.PollOneoff(context, 0, 64, int.MaxValue, out events));
+            Assert.AreEqual(0, events);
+        }
+
+        public static void TestLibcIntrinsics()
+        {
+            var memory = new byte[64];
+            LibcIntrinsics.memset(memory, 8, 'a', 4);
+            Assert.AreEqual(4, LibcIntrinsics.strlen(memory, 8));
+            // overlapping copy behaves like memmove.
+            LibcIntrinsics.memcpy(memory, 10, 8, 4);
+            Assert.AreEqual(6, LibcIntrinsics.strlen(memory, 8));
+            Assert.AreEqual(1, LibcIntrinsics.memcmp(memory, 8, 20, 4));
+            Assert.AreEqual(-1, LibcIntrinsics.memcmp(memory, 20, 8, 4));
+            Assert.AreEqual(0, LibcIntrinsics.memcmp(memory, 8, 10, 4));
+        }
+
+        public static void TestBulkMemory()
+        {
+            var memory = new byte[16];
+            BulkMemory.Fill(0, 7, 4, memory);
+            BulkMemory.Copy(2, 0, 4, memory);
+            Assert.AreEqual(7, memory[5]);
+            BulkMemory.Init(8, 1, 2, new byte[] {1, 2, 3}, memory);
+            Assert.AreEqual(3, memory[9]);
+            // a zero length access at the end of memory is allowed, past it traps.
+            BulkMemory.Fill(16, 0, 0, memory);
+            var trapped = false;
+            try
+            {
+                BulkMemory.Copy(-1, 0, 1, memory);
+            }
+            catch (OutOfBoundsTrap)
+            {
+                trapped = true;
+            }
+            Assert.IsTrue(trapped);
+        }
+
+        public static void TestConversions()
+        {
+            Assert.AreEqual(0, Conversions.I32TruncSatF32S(float.NaN));
+            Assert.AreEqual(int.MinValue, Conversions.I32TruncSatF64S(-3e9));
+            Assert.AreEqual(-1, Conversions.I32TruncSatF64U(4294967295.5));
+            Assert.AreEqual(0, Conversions.I32TruncSatF32U(-0.9f));
+            Assert.AreEqual(long.MaxValue, Conversions.I64TruncSatF32S(1e19f));
+            Assert.AreEqual(unchecked((long) 10_000_000_000_000_000_000UL), Conversions.I64TruncSatF64U(1e19));
+            Assert.AreEqual(0L, Conversions.I64TruncSatF64U(double.NegativeInfinity));
+
+            Assert.AreEqual(-1, Conversions.I32TruncF64U(4294967295.5));
+            Assert.AreEqual(long.MinValue, Conversions.I64TruncF32S(-9223372036854775808f));
+            foreach (var x in new[] {float.NaN, 4294967296f, -1f})
+            {
+                WasmTrap? trap = null;
+                try
+                {
+                    Conversions.I32TruncF32U(x);
+                }
+                catch (WasmTrap e)
+                {
+                    trap = e;
+                }
+
+                Assert.IsTrue(float.IsNaN(x) ? trap is InvalidConversionTrap : trap is IntegerOverflowTrap);
+            }
+        }
+
+        public static void TestTraps()
+        {
+            Assert.IsTrue(Traps.Translate(new OutOfBoundsTrap()) is OutOfBoundsTrap);
+            Assert.IsTrue(Traps.Translate(new Wasi.ProcExitException(0)) == null);
+            // the same exceptions thrown by host code are not traps.
+            try
+            {
+                var array = new int[1];
+                array[Environment.ProcessorCount + 1] = 1;
+            }
+            catch (IndexOutOfRangeException e)
+            {
+                Assert.IsTrue(Traps.Translate(e) == null);
+            }
+
+            // an access that starts in memory but ends past it traps as a whole.
+            var memory = new byte[16];
+            Traps.Access(memory, 8, 4, 4) = 1;
+            Assert.AreEqual(1, memory[12]);
+            var straddling = new[] {(14, 0u, 4), (8, 1u, 8), (-1, 0u, 1), (15, uint.MaxValue, 2)};
+            foreach (var (address, offset, size) in straddling)
+            {
+                var trapped = false;
+                try
+                {
+                    Traps.Access(memory, address, offset, size);
+                }
+                catch (OutOfBoundsTrap)
+                {
+                    trapped = true;
+                }
+
+                Assert.IsTrue(trapped);
+            }
+
+            var table = new object?[] {null, new Func<int>(() => 1), new Action(() => { })};
+            Assert.AreEqual(1, Traps.CallTarget<Func<int>>(table, 1)());
+            foreach (var index in new[] {0, 2, 3, -1})
+            {
+                var trapped = false;
+                try
+                {
+                    Traps.CallTarget<Func<int>>(table, index);
+                }
+                catch (IndirectCallTrap)
+                {
+                    trapped = true;
+                }
+
+                Assert.IsTrue(trapped);
+            }
+        }
+
+        public static void TestDivision()
+        {
+            Assert.AreEqual(0, Division.I32RemS(int.MinValue, -1));
+            Assert.AreEqual(0L, Division.I64RemS(long.MinValue, -1));
+            Assert.AreEqual(-3, Division.I32DivS(-7, 2));
+            Assert.AreEqual(-5L, Division.I64DivS(5, -1));
+            var trapped = false;
+            try
+            {
+                Division.I32DivS(int.MinValue, -1);
+            }
+            catch (IntegerOverflowTrap)
+            {
+                trapped = true;
+            }
+
+            Assert.IsTrue(trapped);
+        }
+
+        public static void TestPeephole()
+        {
+            var module = ModuleDefinition.CreateModule("peephole", ModuleKind.Dll);
+            var method = new MethodDefinition("f", MethodAttributes.Static, module.TypeSystem.Int32);
+            method.Parameters.Add(new ParameterDefinition(module.TypeSystem.Int32));
+            var il = method.Body.GetILProcessor();
+            var target = il.Create(OpCodes.Ldc_I4, 9);
+            il.Emit(OpCodes.Ldarg_0);
+            il.Emit(OpCodes.Ldc_I4_0);
+            il.Emit(OpCodes.Ceq);
+            il.Emit(OpCodes.Brtrue, target);
+            il.Emit(OpCodes.Ldc_I4, 6);
+            il.Emit(OpCodes.Ldc_I4, 7);
+            il.Emit(OpCodes.Mul);
+            il.Emit(OpCodes.Ret);
+            il.Append(target);
+            il.Emit(OpCodes.Ret);
+            Peephole.Optimize(method.Body);
+            var code = method.Body.Instructions;
+            Assert.AreEqual(6, code.Count);
+            Assert.AreEqual(OpCodes.Brfalse, code[1].OpCode);
+            Assert.AreEqual(42, (int) code[2].Operand);
+
+            // a divisor folded to a constant other than 0 and -1 needs no trapping helper.
+            method.Body.Instructions.Clear();
+            il.Emit(OpCodes.Ldarg_0);
+            il.Emit(OpCodes.Ldc_I4, 3);
+            il.Emit(OpCodes.Ldc_I4, 4);
+            il.Emit(OpCodes.Add);
+            il.Emit(OpCodes.Call, module.ImportReference(typeof(Division).GetMethod(nameof(Division.I32RemS))));
+            il.Emit(OpCodes.Ret);
+            Peephole.Optimize(method.Body);
+            Assert.AreEqual(4, code.Count);
+            Assert.AreEqual(OpCodes.Rem, code[2].OpCode);
+        }
+
+        public static void TestLocals()
+        {
+            var module = ModuleDefinition.CreateModule("locals", ModuleKind.Dll);
+            var method = new MethodDefinition("f", MethodAttributes.Static, module.TypeSystem.Int32);
+            var a = new VariableDefinition(module.TypeSystem.Int32);
+            var b = new VariableDefinition(module.TypeSystem.Int32);
+            var unused = new VariableDefinition(module.TypeSystem.Int64);
+            method.Body.Variables.Add(a);
+            method.Body.Variables.Add(b);
+            method.Body.Variables.Add(unused);
+            method.Body.InitLocals = true;
+            var il = method.Body.GetILProcessor();
+            il.Emit(OpCodes.Ldc_I4, 1);
+            il.Emit(OpCodes.Stloc, a);
+            il.Emit(OpCodes.Ldloc, a);
+            il.Emit(OpCodes.Stloc, b);
+            il.Emit(OpCodes.Ldloc, b);
+            il.Emit(OpCodes.Ret);
+            Assert.IsTrue(Locals.Optimize(method.Body));
+            // a and b never overlap and share a slot; nothing is read before it is written.
+            Assert.AreEqual(1, method.Body.Variables.Count);
+            Assert.IsTrue(!method.Body.InitLocals);
+
+            // c is stored once before any read, d is read before its store and still holds zero there.
+            method.Body.Instructions.Clear();
+            method.Body.Variables.Clear();
+            var c = new VariableDefinition(module.TypeSystem.Int32);
+            var d = new VariableDefinition(module.TypeSystem.Int32);
+            method.Body.Variables.Add(c);
+            method.Body.Variables.Add(d);
+            il.Emit(OpCodes.Ldc_I4, 5);
+            il.Emit(OpCodes.Stloc, c);
+            il.Emit(OpCodes.Ldloc, d);
+            il.Emit(OpCodes.Ldc_I4, 6);
+            il.Emit(OpCodes.Stloc, d);
+            il.Emit(OpCodes.Ldloc, c);
+            il.Emit(OpCodes.Ldloc, c);
+            il.Emit(OpCodes.Mul);
+            il.Emit(OpCodes.Add);
+            il.Emit(OpCodes.Ret);
+            Assert.IsTrue(Locals.PropagateConstants(method.Body));
+            Peephole.Optimize(method.Body);
+            Assert.IsTrue(method.Body.Instructions.Any(i => i.OpCode == OpCodes.Ldc_I4 && (int) i.Operand == 25));
+            Assert.IsTrue(method.Body.Instructions.Any(i => i.OpCode == OpCodes.Ldloc && i.Operand == d));
+        }
+
+        public static void TestInliner()
+        {
+            var module = ModuleDefinition.CreateModule("inliner", ModuleKind.Dll);
+            var type = new TypeDefinition("", "Code", TypeAttributes.Class, module.TypeSystem.Object);
+            module.Types.Add(type);
+            var leaf = new MethodDefinition("twice", MethodAttributes.Static, module.TypeSystem.Int32);
+            leaf.Parameters.Add(new ParameterDefinition(module.TypeSystem.Int32));
+            var il = leaf.Body.GetILProcessor();
+            il.Emit(OpCodes.Ldarg_0);
+            il.Emit(OpCodes.Ldc_I4_2);
+            il.Emit(OpCodes.Mul);
+            il.Emit(OpCodes.Ret);
+            var caller = new MethodDefinition("f", MethodAttributes.Static, module.TypeSystem.Int32);
+            il = caller.Body.GetILProcessor();
+            il.Emit(OpCodes.Ldc_I4_1);
+            il.Emit(OpCodes.Ldc_I4_3);
+            il.Emit(OpCodes.Call, leaf);
+            il.Emit(OpCodes.Add);
+            il.Emit(OpCodes.Ret);
+            type.Methods.Add(leaf);
+            type.Methods.Add(caller);
+            var trap = new MethodDefinition("trap", MethodAttributes.Static, module.TypeSystem.Void);
+            trap.Body.GetILProcessor().Emit(OpCodes.Ldnull);
+            trap.Body.GetILProcessor().Emit(OpCodes.Throw);
+            type.Methods.Add(trap);
+            Assert.IsTrue(Inliner.IsLeaf(leaf, 10));
+            Assert.IsTrue(!Inliner.IsLeaf(caller, 10));
+            Assert.IsTrue(!Inliner.IsLeaf(trap, 10));
+            Assert.IsTrue(Inliner.InlineCalls(caller.Body, m => m == leaf));
+            Assert.IsTrue(caller.Body.Instructions.All(i => i.OpCode != OpCodes.Call));
+            Assert.AreEqual(1, caller.Body.Variables.Count);
+        }
+
+        public static void TestMethodPolicy()
+        {
+            var module = ModuleDefinition.CreateModule("policy", ModuleKind.Dll);
+            var trap = new MethodDefinition("trap", MethodAttributes.Static, module.TypeSystem.Void);
+            trap.Body.GetILProcessor().Emit(OpCodes.Ldnull);
+            trap.Body.GetILProcessor().Emit(OpCodes.Throw);
+            var hot = new MethodDefinition("hot", MethodAttributes.Static, module.TypeSystem.Void);
+            for (int i = 0; i < 20; i++)
+                hot.Body.GetILProcessor().Emit(OpCodes.Nop);
+            hot.Body.GetILProcessor().Emit(OpCodes.Ret);
+            var profile = new Profile();
+            profile.Counts["hot"] = 5000;
+            var policy = new MethodPolicy();
+            Assert.AreEqual(MethodImplOptions.NoInlining, policy.Choose(trap, "trap", null));
+            Assert.AreEqual(MethodImplOptions.AggressiveOptimization, policy.Choose(hot, "hot", profile));
+            // a body renamed for a host override is still looked up by its function's name.
+            hot.Name = "hot_pre";
+            Assert.AreEqual(MethodImplOptions.AggressiveOptimization, policy.Choose(hot, "hot", profile));
+            Assert.AreEqual((MethodImplOptions) 0, policy.Choose(hot, null, profile));
+            policy.AddOverride("hot=NoInlining, NoOptimization");
+            Assert.AreEqual(MethodImplOptions.NoInlining | MethodImplOptions.NoOptimization,
+                policy.Choose(hot, "hot", profile));
+            foreach (var spec in new[] {"hot=Synchronized", "hot=Fast", "hot=NoInlining,AggressiveInlining"})
+            {
+                var rejected = false;
+                try
+                {
+                    policy.AddOverride(spec);
+                }
+                catch (ArgumentException)
+                {
+                    rejected = true;
+                }
+
+                Assert.IsTrue(rejected);
+            }
+        }
+
+        public static void TestSimd()
+        {
+            var memory = new byte[32];
+            var v = Simd.I32x4Mul(Simd.I32x4Splat(3), Simd.V128Const(0x0000_0002_0000_0001, 0x0000_0004_0000_0003));
+            Simd.V128Store(12, v, 4, memory);
+            Assert.AreEqual(12, BitConverter.ToInt32(memory, 28));
+            Assert.AreEqual(6, Simd.I32x4ExtractLane(Simd.V128Load(12, 4, memory), 1));
+            Assert.AreEqual(0b1001, Simd.I32x4Bitmask(Simd.I32x4Eq(v, Simd.V128Const(3, 12L << 32))));
+            // indices past 15 select zero.
+            Assert.AreEqual(0, Simd.I8x16ExtractLaneU(Simd.I8x16Swizzle(v, Simd.I8x16Splat(200)), 0));
+            // wasm min propagates NaN, unlike minps.
+            Assert.IsTrue(float.IsNaN(Simd.F32x4ExtractLane(
+                Simd.F32x4Min(Simd.F32x4Splat(float.NaN), Simd.F32x4Splat(1)), 1)));
+            Assert.IsTrue(float.IsNegative(Simd.F32x4ExtractLane(
+                Simd.F32x4Min(Simd.F32x4Splat(0f), Simd.F32x4Splat(-0f)), 2)));
+            Assert.AreEqual(-6L, Simd.I64x2ExtractLane(Simd.I64x2Mul(Simd.I64x2Splat(3), Simd.I64x2Splat(-2)), 1));
+            // every opcode has its Simd method.
+            foreach (var op in Enum.GetValues<Wasm.PrefixFD>())
+            {
+                var name = string.Concat(op.ToString().Split('_').Select(x => x[0] + x.Substring(1).ToLower()));
+                Assert.IsTrue(typeof(Simd).GetMethod(name) != null);
+            }
+            Assert.AreEqual(-1, Simd.I16x8ExtractLaneS(Simd.I8x16GtU(Simd.I8x16Splat(200), Simd.I8x16Splat(100)), 0));
+            Assert.AreEqual(0, Simd.I16x8ExtractLaneS(Simd.I8x16GtS(Simd.I8x16Splat(200), Simd.I8x16Splat(100)), 0));
+            Assert.AreEqual(0b11, Simd.I64x2Bitmask(Simd.I64x2LtS(Simd.I64x2Splat(long.MinValue), Simd.I64x2Splat(0))));
+            Assert.AreEqual(-16, Simd.I8x16ExtractLaneS(Simd.I8x16ShrS(Simd.I8x16Splat(-128), 11), 5));
+            Assert.AreEqual(-2L, Simd.I64x2ExtractLane(Simd.I64x2ShrS(Simd.I64x2Splat(-256), 7), 0));
+            Assert.AreEqual(32767, Simd.I16x8ExtractLaneS(
+                Simd.I16x8Q15mulrSatS(Simd.I16x8Splat(short.MinValue), Simd.I16x8Splat(short.MinValue)), 3));
+            Assert.AreEqual(255, Simd.I8x16ExtractLaneU(Simd.I8x16NarrowI16x8U(Simd.I16x8Splat(300), v), 0));
+            Assert.AreEqual(8, Simd.I8x16ExtractLaneU(Simd.I8x16Popcnt(Simd.I8x16Splat(255)), 9));
+            Assert.AreEqual(-7L, Simd.I64x2ExtractLane(Simd.I64x2ExtendHighI32x4S(Simd.V128Const(0, -7L << 32)), 1));
+            Assert.AreEqual(4294967295.0, Simd.F64x2ExtractLane(Simd.F64x2ConvertLowI32x4U(Simd.I32x4Splat(-1)), 0));
+            Assert.IsTrue(float.IsNegative(Simd.F32x4ExtractLane(Simd.F32x4Nearest(Simd.F32x4Splat(-0.5f)), 0)));
+            Simd.V128Store16Lane(2, Simd.I16x8Splat(0x1234), 7, 0, memory);
+            Assert.AreEqual(0x1234, (int) Simd.I16x8ExtractLaneU(Simd.V128Load16Splat(0, 2, memory), 6));
+            memory[0] = 0xfd;
+            Assert.AreEqual(-3, Simd.I16x8ExtractLaneS(Simd.V128Load8x8S(0, 0, memory), 0));
+            Assert.AreEqual(int.MinValue, Simd.I32x4ExtractLane(
+                Simd.I32x4DotI16x8S(Simd.I16x8Splat(short.MinValue), Simd.I16x8Splat(short.MinValue)), 2));
+            // an address past int.MaxValue is out of bounds, not an overflow.
+            var trapped = false;
+            try
+            {
+                Simd.V128Load(-16, 8, memory);
+            }
+            catch (OutOfBoundsTrap)
+            {
+                trapped = true;
+            }
+
+            Assert.IsTrue(trapped);
+        }
+
+        class Host
+        {
+            [WasmImport("env", "mix")]
+            public int Mix(int a, int b) => a + b;
+
+            [WasmOverride("memcpy")]
+            public static int Memcpy(int dst, int src, int len) => dst;
+        }
+
+        public static void TestHostRegistry()
+        {
+            var reg = HostRegistry.CreateDefault();
+            reg.Register(typeof(Host));
+            Assert.AreEqual("Mix", reg.FindImport("env", "mix")?.Method.Name);
+            Assert.IsTrue(reg.FindImport("other", "mix") == null);
+            Assert.AreEqual(typeof(Host), reg.FindImport("env", "mix")?.InstanceType);
+            Assert.AreEqual("Memcpy", reg.FindOverride("memcpy")?.Method.Name);
+            // Wasi functions are bound by name for any module.
+            var fdWrite = reg.FindImport("wasi_snapshot_preview1", "fd_write");
+            Assert.IsTrue(fdWrite != null && fdWrite.TakesContext);
+        }
     }
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+using System.Reflection;
+
+namespace Wasm2Il;
+
+/// <summary>
+/// Binds a host method to a function the module imports. An empty module matches the name in any module.
+/// If the last parameter is a Wasi.Context, the module's context is passed to it.
+/// </summary>
+[AttributeUsage(AttributeTargets.Method, AllowMultiple = true)]
+public class WasmImportAttribute : Attribute
+{
+    public string Module { get; }
+    public string Name { get; }
+
+    public WasmImportAttribute(string module, string name)
+    {
+        Module = module;
+        Name = name;
+    }
+}
+
+/// <summary>
+/// Replaces a function defined by the module, e.g. a libc function, with a host method. The method may take a
+/// delegate to the original function as the parameter before the Context.
+/// </summary>
+[AttributeUsage(AttributeTargets.Method, AllowMultiple = true)]
+public class WasmOverrideAttribute : Attribute
+{
+    public string Name { get; }
+
+    public WasmOverrideAttribute(string name)
+    {
+        Name = name;
+    }
+}
+
+public class HostFunction
+{
+    public readonly MethodInfo Method;
+
+    /// <summary>
+    /// Set for instance methods; the compiled module fetches the instance through HostRegistry.GetInstance.
+    /// </summary>
+    public readonly Type? InstanceType;
+
+    public HostFunction(MethodInfo method)
+    {
+        Method = method;
+        InstanceType = method.IsStatic ? null : method.DeclaringType;
+    }
+
+    public bool TakesContext
+    {
+        get
+        {
+            var ps = Method.GetParameters();
+            return ps.Length > 0 && ps[^1].ParameterType == typeof(Wasi.Context);
+        }
+    }
+}
+
+/// <summary>
+/// Index of host functions used by the transformer. Types are scanned once when registered,
+/// after which every import and override is a dictionary lookup.
+/// </summary>
+public class HostRegistry
+{
+    /// <summary>
+    /// Registry used when a transformer is not given one. Contains the Wasi functions.
+    /// </summary>
+    public static readonly HostRegistry Default = CreateDefault();
+
+    readonly Dictionary<(string Module, string Name), HostFunction> imports = new();
+    readonly Dictionary<string, HostFunction> overrides = new();
+
+    static readonly Dictionary<Type, object> instances = new();
+
+    public static HostRegistry CreateDefault()
+    {
+        var registry = new HostRegistry();
+        registry.RegisterByName(typeof(Wasi));
+        return registry;
+    }
+
+    /// <summary>
+    /// Registers every public static method that takes a Context as both an import and an override under its
+    /// own name, which is how the Wasi class is bound.
+    /// </summary>
+    public void RegisterByName(Type type)
+    {
+        foreach (var m in type.GetMethods(BindingFlags.Public | BindingFlags.Static))
+        {
+            var f = new HostFunction(m);
+            if (!f.TakesContext) continue;
+            imports[("", m.Name)] = f;
+            overrides[m.Name] = f;
+        }
+    }
+
+    /// <summary>
+    /// Registers the attributed methods of a type. Instance methods are called on 'instance' if given,
+    /// otherwise on a default constructed instance created when the module is first used.
+    /// </summary>
+    public void Register(Type type, object? instance = null)
+    {
+        if (instance != null)
+            SetInstance(type, instance);
+        foreach (var m in type.GetMethods(BindingFlags.Public | BindingFlags.Static | BindingFlags.Instance |
+                                          BindingFlags.DeclaredOnly))
+        {
+            foreach (var imp in m.GetCustomAttributes<WasmImportAttribute>())
+                imports[(imp.Module, imp.Name)] = new HostFunction(m);
+            foreach (var o in m.GetCustomAttributes<WasmOverrideAttribute>())
+                overrides[o.Name] = new HostFunction(m);
+        }
+    }
+
+    public void Register(object instance) => Register(instance.GetType(), instance);
+
+    public void Register(Assembly assembly)
+    {
+        foreach (var type in assembly.GetExportedTypes())
+            Register(type);
+    }
+
+    public HostFunction? FindImport(string module, string name)
+    {
+        if (imports.TryGetValue((module, name), out var f) || imports.TryGetValue(("", name), out f))
+            return f;
+        return null;
+    }
+
+    public HostFunction? FindOverride(string name) => overrides.TryGetValue(name, out var f) ? f : null;
+
+    /// <summary>
+    /// Provides the object used for instance-bound host functions of its type. Must be called before the
+    /// compiled module is first used.
+    /// </summary>
+    public static void SetInstance(Type type, object instance)
+    {
+        lock (instances)
+            instances[type] = instance;
+    }
+
+    public static object GetInstance(RuntimeTypeHandle handle)
+    {
+        var type = Type.GetTypeFromHandle(handle)!;
+        lock (instances)
+        {
+            if (!instances.TryGetValue(type, out var instance))
+                instances[type] = instance = Activator.CreateInstance(type)!;
+            return instance;
+        }
+    }
+}
@@ -0,0 +1,178 @@
+using Mono.Cecil;
+using Mono.Cecil.Cil;
+
+namespace Wasm2Il;
+
+/// <summary>
+/// Splices small leaf functions into their callers. The JIT refuses to inline many of the accessors and wrappers
+/// a C compiler leaves behind, because of their IL size or their use of the static Memory field. A leaf is a
+/// function that calls no other function of the module, so inlining never recurses. The callee's arguments and
+/// locals become locals of the caller and its returns become branches past the spliced body.
+/// </summary>
+public static class Inliner
+{
+    /// <summary>
+    /// Whether a method may be inlined: at most budget IL instructions, no calls into its own type, and locals
+    /// that can be zeroed with a constant if the method relies on InitLocals. Loops are left out as well: the
+    /// caller's operands stay on the stack under the spliced code, and IL wants it empty at a backward branch.
+    /// So are bodies that never return, such as import stubs and traps, which belong on the cold path.
+    /// </summary>
+    public static bool IsLeaf(MethodDefinition method, int budget)
+    {
+        if (!method.HasBody || method.Body.Instructions.Count > budget || method.Body.HasExceptionHandlers)
+            return false;
+        if (method.Body.InitLocals && method.Body.Variables.Any(v => zero(v.VariableType) == null))
+            return false;
+        if (method.Body.Instructions.All(i => i.OpCode != OpCodes.Ret))
+            return false;
+        var seen = new HashSet<Instruction>();
+        foreach (var i in method.Body.Instructions)
+        {
+            seen.Add(i);
+            if (i.Operand is MethodReference m && m.DeclaringType == method.DeclaringType)
+                return false;
+            if (i.Operand is Instruction target && seen.Contains(target) ||
+                i.Operand is Instruction[] targets && targets.Any(seen.Contains))
+                return false;
+            if (i.OpCode.Code is Code.Jmp or Code.Localloc or Code.Tail or Code.Arglist)
+                return false;
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Inlines every call in the body to a method for which inline returns true. Returns whether any call was
+    /// inlined; the body is then left with nops and branches to the next instruction for the branch cleanup.
+    /// </summary>
+    public static bool InlineCalls(MethodBody body, Func<MethodDefinition, bool> inline)
+    {
+        bool changed = false;
+        var ins = body.Instructions;
+        for (int k = 0; k < ins.Count; k++)
+        {
+            if (ins[k].OpCode != OpCodes.Call || ins[k].Operand is not MethodDefinition callee ||
+                callee == body.Method || !inline(callee))
+                continue;
+            k = splice(body, k, callee);
+            changed = true;
+        }
+
+        return changed;
+    }
+
+    /// <summary>
+    /// Replaces the call at index k with the callee's body and returns the index of its last instruction.
+    /// </summary>
+    static int splice(MethodBody body, int k, MethodDefinition callee)
+    {
+        var ins = body.Instructions;
+        var call = ins[k];
+        var code = new List<Instruction>();
+        var args = callee.Parameters.Select(p => new VariableDefinition(p.ParameterType)).ToArray();
+        var locals = callee.Body.Variables.Select(v => new VariableDefinition(v.VariableType)).ToArray();
+        foreach (var v in args.Concat(locals))
+            body.Variables.Add(v);
+
+        // the arguments are on the stack, the last one on top.
+        for (int a = args.Length - 1; a >= 0; a--)
+            code.Add(Instruction.Create(OpCodes.Stloc, args[a]));
+        if (callee.Body.InitLocals)
+        {
+            foreach (var v in locals)
+            {
+                code.Add(zero(v.VariableType)!);
+                code.Add(Instruction.Create(OpCodes.Stloc, v));
+            }
+        }
+
+        var end = Instruction.Create(OpCodes.Nop);
+        var map = new Dictionary<Instruction, Instruction>();
+        foreach (var i in callee.Body.Instructions)
+        {
+            var copy = Instruction.Create(OpCodes.Nop);
+            copy.OpCode = i.OpCode;
+            copy.Operand = i.Operand;
+            map[i] = copy;
+            code.Add(copy);
+        }
+
+        foreach (var copy in map.Values)
+        {
+            if (copy.OpCode == OpCodes.Ret)
+            {
+                copy.OpCode = OpCodes.Br;
+                copy.Operand = end;
+            }
+            else if (copy.Operand is Instruction target)
+                copy.Operand = map[target];
+            else if (copy.Operand is Instruction[] targets)
+                copy.Operand = targets.Select(t => map[t]).ToArray();
+            else if (argument(copy) is { } p)
+            {
+                copy.OpCode = copy.OpCode.Code switch
+                {
+                    Code.Starg or Code.Starg_S => OpCodes.Stloc,
+                    Code.Ldarga or Code.Ldarga_S => OpCodes.Ldloca,
+                    _ => OpCodes.Ldloc
+                };
+                copy.Operand = args[p];
+            }
+            else if (local(copy) is { } v)
+            {
+                copy.OpCode = copy.OpCode.Code switch
+                {
+                    Code.Stloc or Code.Stloc_S or >= Code.Stloc_0 and <= Code.Stloc_3 => OpCodes.Stloc,
+                    Code.Ldloca or Code.Ldloca_S => OpCodes.Ldloca,
+                    _ => OpCodes.Ldloc
+                };
+                copy.Operand = locals[v];
+            }
+        }
+
+        code.Add(end);
+
+        // the call itself may be a branch target, so it becomes the first instruction of the spliced code.
+        call.OpCode = code[0].OpCode;
+        call.Operand = code[0].Operand;
+        foreach (var i in code)
+        {
+            if (i.Operand == code[0])
+                i.Operand = call;
+            else if (i.Operand is Instruction[] targets)
+                for (int t = 0; t < targets.Length; t++)
+                    if (targets[t] == code[0])
+                        targets[t] = call;
+        }
+
+        for (int c = 1; c < code.Count; c++)
+            ins.Insert(k + c, code[c]);
+        return k + code.Count - 1;
+    }
+
+    static int? argument(Instruction i) => i.OpCode.Code switch
+    {
+        >= Code.Ldarg_0 and <= Code.Ldarg_3 => i.OpCode.Code - Code.Ldarg_0,
+        Code.Ldarg or Code.Ldarg_S or Code.Starg or Code.Starg_S or Code.Ldarga or Code.Ldarga_S =>
+            ((ParameterDefinition) i.Operand).Index,
+        _ => null
+    };
+
+    static int? local(Instruction i) => i.OpCode.Code switch
+    {
+        >= Code.Ldloc_0 and <= Code.Ldloc_3 => i.OpCode.Code - Code.Ldloc_0,
+        >= Code.Stloc_0 and <= Code.Stloc_3 => i.OpCode.Code - Code.Stloc_0,
+        Code.Ldloc or Code.Ldloc_S or Code.Stloc or Code.Stloc_S or Code.Ldloca or Code.Ldloca_S =>
+            ((VariableDefinition) i.Operand).Index,
+        _ => null
+    };
+
+    static Instruction? zero(TypeReference type) => type.MetadataType switch
+    {
+        MetadataType.Int32 => Instruction.Create(OpCodes.Ldc_I4_0),
+        MetadataType.Int64 => Instruction.Create(OpCodes.Ldc_I8, 0L),
+        MetadataType.Single => Instruction.Create(OpCodes.Ldc_R4, 0f),
+        MetadataType.Double => Instruction.Create(OpCodes.Ldc_R8, 0d),
+        _ => null
+    };
+}
@@ -0,0 +1,312 @@
+using Mono.Cecil.Cil;
+
+namespace Wasm2Il;
+
+/// <summary>
+/// Shrinks the locals of a compiled function. The transformer declares every wasm local and a typed temporary
+/// per use site; a liveness analysis over the body lets locals of the same type whose live ranges do not overlap
+/// share a slot, turns stores to locals that are never read into pops and drops locals that are never used.
+/// InitLocals is only kept when a local may be read before it is written, which wasm defines as zero.
+/// The same analysis drives the constant propagation of the optimizing tier.
+/// </summary>
+public static class Locals
+{
+    /// <summary>
+    /// Returns true if a store was turned into a pop or locals were merged, which can leave work for the peephole
+    /// pass: a pushed value that is now dropped, or a copy between two locals that now share a slot.
+    /// </summary>
+    public static bool Optimize(MethodBody body)
+    {
+        var ins = body.Instructions;
+        var vars = body.Variables;
+        int n = vars.Count;
+        if (n == 0 || body.HasExceptionHandlers)
+            return false;
+
+        normalize(ins, vars);
+        var read = new bool[n];
+        var pinned = new bool[n];
+        foreach (var i in ins)
+        {
+            if (i.Operand is not VariableDefinition v)
+                continue;
+            read[v.Index] |= i.OpCode.Code != Code.Stloc;
+            // the address is only used to read fields of a tuple right away, but keep the local to itself.
+            pinned[v.Index] |= i.OpCode.Code == Code.Ldloca;
+        }
+
+        bool changed = false;
+        foreach (var i in ins)
+        {
+            if (i.OpCode.Code == Code.Stloc && i.Operand is VariableDefinition v && !read[v.Index])
+            {
+                i.OpCode = OpCodes.Pop;
+                i.Operand = null;
+                changed = true;
+            }
+        }
+
+        var blocks = basicBlocks(ins);
+        int words = (n + 63) / 64;
+        liveness(ins, blocks, words, out var liveIn, out var liveOut);
+
+        // a store interferes with every other local live after it.
+        var interferes = new ulong[n][];
+        for (int v = 0; v < n; v++)
+            interferes[v] = new ulong[words];
+        var live = new ulong[words];
+        for (int b = 0; b < blocks.Count; b++)
+        {
+            Array.Copy(liveOut[b], live, words);
+            for (int k = blocks[b].End - 1; k >= blocks[b].Start; k--)
+            {
+                if (ins[k].Operand is not VariableDefinition v)
+                    continue;
+                if (ins[k].OpCode.Code != Code.Stloc)
+                {
+                    set(live, v.Index);
+                    continue;
+                }
+
+                clear(live, v.Index);
+                for (int w = 0; w < words; w++)
+                {
+                    interferes[v.Index][w] |= live[w];
+                    for (var bits = live[w]; bits != 0; bits &= bits - 1)
+                        set(interferes[w * 64 + System.Numerics.BitOperations.TrailingZeroCount(bits)], v.Index);
+                }
+            }
+        }
+
+        // greedy coalescing in declaration order; a slot collects the interference of its members.
+        var slotOf = new VariableDefinition?[n];
+        var slots = new List<(VariableDefinition Slot, ulong[] Interferes)>();
+        var entry = blocks.Count > 0 ? liveIn[0] : new ulong[words];
+        bool initLocals = false;
+        for (int v = 0; v < n; v++)
+        {
+            // its stores were all dropped above.
+            if (!read[v])
+                continue;
+            initLocals |= get(entry, v);
+            int found = -1;
+            if (!pinned[v])
+            {
+                for (int s = 0; s < slots.Count && found < 0; s++)
+                {
+                    var slot = slots[s].Slot;
+                    if (!pinned[slot.Index] && slot.VariableType.FullName == vars[v].VariableType.FullName &&
+                        !get(slots[s].Interferes, v))
+                        found = s;
+                }
+            }
+
+            if (found < 0)
+            {
+                slots.Add((vars[v], (ulong[]) interferes[v].Clone()));
+                slotOf[v] = vars[v];
+                continue;
+            }
+
+            slotOf[v] = slots[found].Slot;
+            changed = true;
+            for (int w = 0; w < words; w++)
+                slots[found].Interferes[w] |= interferes[v][w];
+        }
+
+        foreach (var i in ins)
+            if (i.Operand is VariableDefinition v)
+                i.Operand = slotOf[v.Index];
+        vars.Clear();
+        foreach (var slot in slots)
+            vars.Add(slot.Slot);
+        body.InitLocals = initLocals;
+        return changed;
+    }
+
+    /// <summary>
+    /// Replaces the loads of a local by a constant if its only store writes that constant and no load can run
+    /// before the store. Returns true if a load was replaced; the store is left for Optimize to drop.
+    /// </summary>
+    public static bool PropagateConstants(MethodBody body)
+    {
+        var ins = body.Instructions;
+        var vars = body.Variables;
+        int n = vars.Count;
+        if (n == 0 || body.HasExceptionHandlers)
+            return false;
+
+        normalize(ins, vars);
+        var targets = new HashSet<Instruction>(ins.SelectMany(Locals.targets));
+        var stores = new int[n];
+        var pinned = new bool[n];
+        var constant = new Instruction?[n];
+        for (int k = 0; k < ins.Count; k++)
+        {
+            if (ins[k].Operand is not VariableDefinition v)
+                continue;
+            pinned[v.Index] |= ins[k].OpCode.Code == Code.Ldloca;
+            if (ins[k].OpCode.Code != Code.Stloc)
+                continue;
+            stores[v.Index]++;
+            // a branch to the store may bring another value.
+            constant[v.Index] = k > 0 && isConstant(ins[k - 1]) && !targets.Contains(ins[k]) ? ins[k - 1] : null;
+        }
+
+        var blocks = basicBlocks(ins);
+        int words = (n + 63) / 64;
+        liveness(ins, blocks, words, out var liveIn, out _);
+        // a local that is not live on entry is written on every path to a load, here always by its one store.
+        var entry = blocks.Count > 0 ? liveIn[0] : new ulong[words];
+        bool changed = false;
+        foreach (var i in ins)
+        {
+            if (i.OpCode.Code != Code.Ldloc || i.Operand is not VariableDefinition v || stores[v.Index] != 1 ||
+                pinned[v.Index] || get(entry, v.Index) || constant[v.Index] is not { } c)
+                continue;
+            i.OpCode = c.OpCode;
+            i.Operand = c.Operand;
+            changed = true;
+        }
+
+        return changed;
+    }
+
+    static bool isConstant(Instruction i) =>
+        i.OpCode.Code is >= Code.Ldc_I4_M1 and <= Code.Ldc_R8;
+
+    /// <summary>
+    /// Rewrites the short forms of local accesses so every access carries its variable.
+    /// </summary>
+    static void normalize(Mono.Collections.Generic.Collection<Instruction> ins,
+        Mono.Collections.Generic.Collection<VariableDefinition> vars)
+    {
+        foreach (var i in ins)
+        {
+            if (variable(i, vars) is not { } v)
+                continue;
+            var code = i.OpCode.Code;
+            i.OpCode = isLoad(code) ? OpCodes.Ldloc : isStore(code) ? OpCodes.Stloc : OpCodes.Ldloca;
+            i.Operand = v;
+        }
+    }
+
+    static void liveness(Mono.Collections.Generic.Collection<Instruction> ins, List<Block> blocks, int words,
+        out ulong[][] liveIn, out ulong[][] liveOut)
+    {
+        liveIn = new ulong[blocks.Count][];
+        liveOut = new ulong[blocks.Count][];
+        var use = new ulong[blocks.Count][];
+        var def = new ulong[blocks.Count][];
+        for (int b = 0; b < blocks.Count; b++)
+        {
+            liveIn[b] = new ulong[words];
+            liveOut[b] = new ulong[words];
+            use[b] = new ulong[words];
+            def[b] = new ulong[words];
+            for (int k = blocks[b].Start; k < blocks[b].End; k++)
+            {
+                if (ins[k].Operand is not VariableDefinition v)
+                    continue;
+                if (ins[k].OpCode.Code == Code.Stloc)
+                    set(def[b], v.Index);
+                else if (!get(def[b], v.Index))
+                    set(use[b], v.Index);
+            }
+        }
+
+        for (bool iterate = true; iterate;)
+        {
+            iterate = false;
+            for (int b = blocks.Count - 1; b >= 0; b--)
+            {
+                foreach (var s in blocks[b].Successors)
+                for (int w = 0; w < words; w++)
+                    liveOut[b][w] |= liveIn[s][w];
+                for (int w = 0; w < words; w++)
+                {
+                    var value = use[b][w] | (liveOut[b][w] & ~def[b][w]);
+                    iterate |= value != liveIn[b][w];
+                    liveIn[b][w] = value;
+                }
+            }
+        }
+    }
+
+    class Block
+    {
+        public int Start, End;
+        public readonly List<int> Successors = new();
+    }
+
+    static List<Block> basicBlocks(Mono.Collections.Generic.Collection<Instruction> ins)
+    {
+        var index = new Dictionary<Instruction, int>();
+        for (int k = 0; k < ins.Count; k++)
+            index[ins[k]] = k;
+
+        var leaders = new SortedSet<int> {0};
+        for (int k = 0; k < ins.Count; k++)
+        {
+            var flow = ins[k].OpCode.FlowControl;
+            foreach (var t in targets(ins[k]))
+                leaders.Add(index[t]);
+            if (flow is FlowControl.Branch or FlowControl.Cond_Branch or FlowControl.Return or FlowControl.Throw &&
+                k + 1 < ins.Count)
+                leaders.Add(k + 1);
+        }
+
+        var blocks = new List<Block>();
+        var blockAt = new Dictionary<int, int>();
+        foreach (var start in leaders)
+        {
+            if (start >= ins.Count)
+                continue;
+            blockAt[start] = blocks.Count;
+            blocks.Add(new Block {Start = start});
+        }
+
+        for (int b = 0; b < blocks.Count; b++)
+        {
+            var block = blocks[b];
+            block.End = b + 1 < blocks.Count ? blocks[b + 1].Start : ins.Count;
+            var last = ins[block.End - 1];
+            foreach (var t in targets(last))
+                block.Successors.Add(blockAt[index[t]]);
+            if (last.OpCode.FlowControl is not (FlowControl.Branch or FlowControl.Return or FlowControl.Throw) &&
+                b + 1 < blocks.Count)
+                block.Successors.Add(b + 1);
+        }
+
+        return blocks;
+    }
+
+    static IEnumerable<Instruction> targets(Instruction i) => i.Operand switch
+    {
+        Instruction t => new[] {t},
+        Instruction[] ts => ts,
+        _ => Array.Empty<Instruction>()
+    };
+
+    static VariableDefinition? variable(Instruction i, Mono.Collections.Generic.Collection<VariableDefinition> vars) =>
+        i.OpCode.Code switch
+        {
+            Code.Ldloc_0 or Code.Stloc_0 => vars[0],
+            Code.Ldloc_1 or Code.Stloc_1 => vars[1],
+            Code.Ldloc_2 or Code.Stloc_2 => vars[2],
+            Code.Ldloc_3 or Code.Stloc_3 => vars[3],
+            Code.Ldloc or Code.Ldloc_S or Code.Stloc or Code.Stloc_S or Code.Ldloca or Code.Ldloca_S =>
+                (VariableDefinition) i.Operand,
+            _ => null
+        };
+
+    static bool isLoad(Code code) => code is Code.Ldloc or Code.Ldloc_S or >= Code.Ldloc_0 and <= Code.Ldloc_3;
+
+    static bool isStore(Code code) => code is Code.Stloc or Code.Stloc_S or >= Code.Stloc_0 and <= Code.Stloc_3;
+
+    static bool get(ulong[] set, int i) => (set[i >> 6] & (1UL << i)) != 0;
+
+    static void set(ulong[] set, int i) => set[i >> 6] |= 1UL << i;
+
+    static void clear(ulong[] set, int i) => set[i >> 6] &= ~(1UL << i);
+}
@@ -0,0 +1,103 @@
+using System.Runtime.CompilerServices;
+using Mono.Cecil;
+using Mono.Cecil.Cil;
+
+namespace Wasm2Il;
+
+/// <summary>
+/// Chooses the MethodImpl flags of generated methods, which the JIT otherwise has to guess:
+/// functions the profile marks hot skip tier 0 with AggressiveOptimization, small functions get AggressiveInlining,
+/// and functions that never return or never ran are kept out of their callers with NoInlining.
+/// Overrides name the flags of single functions and win over the heuristics.
+/// </summary>
+public class MethodPolicy
+{
+    /// <summary>
+    /// Functions of at most this many IL instructions are marked AggressiveInlining.
+    /// </summary>
+    public int SmallMethodSize = 16;
+
+    /// <summary>
+    /// Leaves the InitLocals flag to the locals pass, which keeps it only where a local may be read before it is
+    /// written. Turning this off zero-initializes the locals of every method.
+    /// </summary>
+    public bool SkipLocalsInit = true;
+
+    public readonly Dictionary<string, MethodImplOptions> Overrides = new();
+
+    /// <summary>
+    /// The options an override may set; the others change how a method is compiled or called, not how well.
+    /// </summary>
+    public const MethodImplOptions OverridableOptions = MethodImplOptions.AggressiveInlining |
+        MethodImplOptions.NoInlining | MethodImplOptions.AggressiveOptimization | MethodImplOptions.NoOptimization;
+
+    static readonly MethodImplOptions[] conflicts =
+    {
+        MethodImplOptions.AggressiveInlining | MethodImplOptions.NoInlining,
+        MethodImplOptions.AggressiveOptimization | MethodImplOptions.NoOptimization
+    };
+
+    /// <summary>
+    /// Adds an override of the form name=Option[,Option], e.g. sqlite3VdbeExec=AggressiveOptimization.
+    /// </summary>
+    public void AddOverride(string spec)
+    {
+        var parts = spec.Split('=', 2);
+        if (parts.Length != 2)
+            throw new ArgumentException("expected name=Option[,Option]: " + spec);
+        MethodImplOptions options = 0;
+        foreach (var name in parts[1].Split(',', StringSplitOptions.RemoveEmptyEntries | StringSplitOptions.TrimEntries))
+        {
+            if (!Enum.TryParse<MethodImplOptions>(name, true, out var option) || option == 0 ||
+                (option & ~OverridableOptions) != 0)
+                throw new ArgumentException($"unsupported option {name}, expected one of {OverridableOptions}");
+            options |= option;
+        }
+
+        foreach (var pair in conflicts)
+        {
+            if ((options & pair) == pair)
+                throw new ArgumentException($"conflicting options {pair}: " + spec);
+        }
+
+        Overrides[parts[0]] = options;
+    }
+
+    /// <summary>
+    /// Chooses the options of a method translating the module function named function. Overrides and the profile
+    /// are keyed on that name, which is not the method's own name when a host override wraps the function; methods
+    /// translating no function, such as the wrappers and import stubs, only get the size heuristics.
+    /// </summary>
+    public MethodImplOptions Choose(MethodDefinition method, string? function, Profile? profile)
+    {
+        if (function != null && Overrides.TryGetValue(function, out var options))
+            return options;
+        var body = method.Body;
+        // traps and unimplemented imports.
+        if (body.Instructions.All(i => i.OpCode != OpCodes.Ret))
+            return MethodImplOptions.NoInlining;
+        options = body.Instructions.Count <= SmallMethodSize ? MethodImplOptions.AggressiveInlining : 0;
+        if (profile == null || function == null)
+            return options;
+        if (profile.IsHot(function))
+            return options | MethodImplOptions.AggressiveOptimization;
+        return options != 0 || profile.Counts.ContainsKey(function) ? options : MethodImplOptions.NoInlining;
+    }
+
+    /// <summary>
+    /// Applies the policy to every method of the generated type but its static constructor. functionName maps a
+    /// method to the module function it translates, or null.
+    /// </summary>
+    public void Apply(TypeDefinition type, Profile? profile, Func<MethodDefinition, string?> functionName)
+    {
+        foreach (var method in type.Methods)
+        {
+            if (method.IsConstructor || !method.HasBody)
+                continue;
+            // the Cecil enum predates AggressiveOptimization, the values are the same.
+            method.ImplAttributes |= (MethodImplAttributes) Choose(method, functionName(method), profile);
+            if (!SkipLocalsInit)
+                method.Body.InitLocals = true;
+        }
+    }
+}
@@ -0,0 +1,253 @@
+using Mono.Cecil;
+using Mono.Cecil.Cil;
+
+namespace Wasm2Il;
+
+/// <summary>
+/// Peephole optimizations over a compiled function body. The transformer emits one IL sequence per wasm
+/// instruction; this folds constant expressions, turns signed divisions by a safe constant into plain div/rem,
+/// fuses compares into branches and removes values that are pushed only to be dropped. Instructions other than the first of a pattern are only removed when no branch
+/// targets them, so the rewrites are safe anywhere in the body.
+/// </summary>
+public static class Peephole
+{
+    public static void Optimize(MethodBody body)
+    {
+        // each pass can expose new patterns, e.g. a folded constant feeding a compare.
+        for (int pass = 0; pass < 4 && optimizePass(body); pass++)
+        {
+        }
+    }
+
+    static bool optimizePass(MethodBody body)
+    {
+        var ins = body.Instructions;
+        var targets = new HashSet<Instruction>();
+        foreach (var i in ins)
+        {
+            if (i.Operand is Instruction t)
+                targets.Add(t);
+            else if (i.Operand is Instruction[] ts)
+                targets.UnionWith(ts);
+        }
+
+        bool removable(int index, int count)
+        {
+            if (index + count > ins.Count)
+                return false;
+            for (int k = index; k < index + count; k++)
+                if (targets.Contains(ins[k]))
+                    return false;
+            return true;
+        }
+
+        bool changed = false;
+        for (int k = 0; k < ins.Count; k++)
+        {
+            var a = ins[k];
+            var b = k + 1 < ins.Count ? ins[k + 1] : null;
+            var c = k + 2 < ins.Count ? ins[k + 2] : null;
+            if (b == null)
+                break;
+
+            // constant op constant
+            if (c != null && isConstant(a, out var x) && isConstant(b, out var y) && removable(k + 1, 2) &&
+                fold(c.OpCode, a.OpCode == OpCodes.Ldc_I8, x, y, out var folded))
+            {
+                setConstant(a, folded.Value, folded.Is64);
+                ins.RemoveAt(k + 1);
+                ins.RemoveAt(k + 1);
+                changed = true;
+                k--;
+                continue;
+            }
+
+            // widening or narrowing a constant
+            if (isConstant(a, out x) && removable(k + 1, 1) && convert(b.OpCode, a.OpCode == OpCodes.Ldc_I8, x, out folded))
+            {
+                setConstant(a, folded.Value, folded.Is64);
+                ins.RemoveAt(k + 1);
+                changed = true;
+                k--;
+                continue;
+            }
+
+            // a constant divisor other than 0 and -1 cannot trap, and the JIT turns the division into a
+            // multiplication. The call must not be a branch target, or the divisor may come from elsewhere.
+            if (isConstant(a, out x) && x is not (0 or -1) && removable(k + 1, 1) && divisionHelper(b) is { } division)
+            {
+                b.OpCode = division;
+                b.Operand = null;
+                changed = true;
+                continue;
+            }
+
+            // x == 0 feeding a branch, as emitted for eqz: branch on x itself with the condition inverted.
+            if (c != null && isConstant(a, out x) && x == 0 && b.OpCode == OpCodes.Ceq &&
+                (c.OpCode == OpCodes.Brtrue || c.OpCode == OpCodes.Brfalse) && removable(k + 1, 2))
+            {
+                a.OpCode = c.OpCode == OpCodes.Brtrue ? OpCodes.Brfalse : OpCodes.Brtrue;
+                a.Operand = c.Operand;
+                ins.RemoveAt(k + 1);
+                ins.RemoveAt(k + 1);
+                changed = true;
+                continue;
+            }
+
+            // compare feeding a branch
+            if (removable(k + 1, 1) && fusedBranch(a.OpCode, b.OpCode) is { } branch)
+            {
+                a.OpCode = branch;
+                a.Operand = b.Operand;
+                ins.RemoveAt(k + 1);
+                changed = true;
+                continue;
+            }
+
+            // a local copied to itself
+            if (a.OpCode == OpCodes.Ldloc && b.OpCode == OpCodes.Stloc && a.Operand == b.Operand && removable(k, 2))
+            {
+                ins.RemoveAt(k);
+                ins.RemoveAt(k);
+                changed = true;
+                k = Math.Max(-1, k - 2);
+                continue;
+            }
+
+            // a value pushed only to be popped
+            if (b.OpCode == OpCodes.Pop && isPureLoad(a) && removable(k, 2))
+            {
+                ins.RemoveAt(k);
+                ins.RemoveAt(k);
+                changed = true;
+                k = Math.Max(-1, k - 2);
+            }
+        }
+
+        return changed;
+    }
+
+    /// <summary>
+    /// The raw instruction for a call to one of the signed Division helpers, which only exist to trap.
+    /// </summary>
+    static OpCode? divisionHelper(Instruction i)
+    {
+        if (i.OpCode != OpCodes.Call || i.Operand is not MethodReference m ||
+            m.DeclaringType.FullName != typeof(Division).FullName)
+            return null;
+        return m.Name switch
+        {
+            nameof(Division.I32DivS) or nameof(Division.I64DivS) => OpCodes.Div,
+            nameof(Division.I32RemS) or nameof(Division.I64RemS) => OpCodes.Rem,
+            _ => null
+        };
+    }
+
+    static bool isPureLoad(Instruction i)
+    {
+        var code = i.OpCode.Code;
+        return i.OpCode == OpCodes.Dup || isConstant(i, out _) || i.OpCode == OpCodes.Ldc_R4 ||
+               i.OpCode == OpCodes.Ldc_R8 || code is >= Code.Ldarg_0 and <= Code.Ldloc_3 || code == Code.Ldarg ||
+               code == Code.Ldarg_S || code == Code.Ldloc || code == Code.Ldloc_S || code == Code.Ldsfld;
+    }
+
+    static bool isConstant(Instruction i, out long value)
+    {
+        value = 0;
+        switch (i.OpCode.Code)
+        {
+            case Code.Ldc_I4:
+                value = (int) i.Operand;
+                return true;
+            case Code.Ldc_I4_S:
+                value = (sbyte) i.Operand;
+                return true;
+            case Code.Ldc_I8:
+                value = (long) i.Operand;
+                return true;
+            case Code.Ldc_I4_M1:
+                value = -1;
+                return true;
+            case >= Code.Ldc_I4_0 and <= Code.Ldc_I4_8:
+                value = i.OpCode.Code - Code.Ldc_I4_0;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    static void setConstant(Instruction i, long value, bool is64)
+    {
+        i.OpCode = is64 ? OpCodes.Ldc_I8 : OpCodes.Ldc_I4;
+        i.Operand = is64 ? value : (object) (int) value;
+    }
+
+    static bool fold(OpCode op, bool is64, long x, long y, out (long Value, bool Is64) result)
+    {
+        result = default;
+        int shift = (int) y & (is64 ? 63 : 31);
+        long value;
+        switch (op.Code)
+        {
+            case Code.Add: value = x + y; break;
+            case Code.Sub: value = x - y; break;
+            case Code.Mul: value = x * y; break;
+            case Code.And: value = x & y; break;
+            case Code.Or: value = x | y; break;
+            case Code.Xor: value = x ^ y; break;
+            case Code.Shl: value = x << shift; break;
+            case Code.Shr: value = is64 ? x >> shift : (int) x >> shift; break;
+            case Code.Shr_Un: value = is64 ? (long) ((ulong) x >> shift) : (uint) x >> shift; break;
+            case Code.Ceq: result = (x == y ? 1 : 0, false); return true;
+            case Code.Cgt: result = (x > y ? 1 : 0, false); return true;
+            case Code.Clt: result = (x < y ? 1 : 0, false); return true;
+            case Code.Cgt_Un: result = (unsigned(x, is64) > unsigned(y, is64) ? 1 : 0, false); return true;
+            case Code.Clt_Un: result = (unsigned(x, is64) < unsigned(y, is64) ? 1 : 0, false); return true;
+            default: return false;
+        }
+
+        result = (is64 ? value : (int) value, is64);
+        return true;
+    }
+
+    static ulong unsigned(long x, bool is64) => is64 ? (ulong) x : (uint) x;
+
+    static bool convert(OpCode op, bool is64, long x, out (long Value, bool Is64) result)
+    {
+        switch (op.Code)
+        {
+            case Code.Conv_I8:
+                result = (x, true);
+                return true;
+            case Code.Conv_U8:
+                result = (is64 ? x : (uint) x, true);
+                return true;
+            case Code.Conv_I4:
+                result = ((int) x, false);
+                return true;
+            case Code.Neg:
+                result = (is64 ? -x : -(int) x, is64);
+                return true;
+            default:
+                result = default;
+                return false;
+        }
+    }
+
+    static OpCode? fusedBranch(OpCode compare, OpCode branch)
+    {
+        if (branch == OpCodes.Brtrue)
+        {
+            if (compare == OpCodes.Ceq) return OpCodes.Beq;
+            if (compare == OpCodes.Cgt) return OpCodes.Bgt;
+            if (compare == OpCodes.Cgt_Un) return OpCodes.Bgt_Un;
+            if (compare == OpCodes.Clt) return OpCodes.Blt;
+            if (compare == OpCodes.Clt_Un) return OpCodes.Blt_Un;
+        }
+
+        // the other inversions depend on whether the operands are floats, which is not known here.
+        if (branch == OpCodes.Brfalse && compare == OpCodes.Ceq)
+            return OpCodes.Bne_Un;
+        return null;
+    }
+}
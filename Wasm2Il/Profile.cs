@@ -0,0 +1,58 @@
+using System.Globalization;
+using System.Reflection;
+
+namespace Wasm2Il;
+
+/// <summary>
+/// Execution counts per function, collected from a module translated with Transformer.CountCalls and used to
+/// pick the tier each function is translated with. A function's count is the number of times it was entered
+/// plus the number of loop iterations in it, so a function that is called once but spins in a loop is hot too.
+/// The file format is one "count name" pair per line.
+/// </summary>
+public class Profile
+{
+    /// <summary>
+    /// The prefix of the static counter fields in an instrumented module.
+    /// </summary>
+    public const string CounterPrefix = "calls_";
+
+    public readonly Dictionary<string, long> Counts = new();
+
+    /// <summary>
+    /// Functions counted at least this often are translated with the optimizing tier.
+    /// </summary>
+    public long HotThreshold = 1000;
+
+    public bool IsHot(string function) => Counts.TryGetValue(function, out var count) && count >= HotThreshold;
+
+    /// <summary>
+    /// Reads the counters of an instrumented module after it has run.
+    /// </summary>
+    public static Profile Collect(Type code)
+    {
+        var profile = new Profile();
+        foreach (var field in code.GetFields(BindingFlags.Static | BindingFlags.NonPublic))
+        {
+            if (field.Name.StartsWith(CounterPrefix) && field.GetValue(null) is long count && count > 0)
+                profile.Counts[field.Name.Substring(CounterPrefix.Length)] = count;
+        }
+
+        return profile;
+    }
+
+    public static Profile Load(string path)
+    {
+        var profile = new Profile();
+        foreach (var line in File.ReadLines(path))
+        {
+            var parts = line.Trim().Split(' ', 2);
+            if (parts.Length == 2 && long.TryParse(parts[0], NumberStyles.Integer, CultureInfo.InvariantCulture, out var count))
+                profile.Counts[parts[1]] = count;
+        }
+
+        return profile;
+    }
+
+    public void Save(string path) =>
+        File.WriteAllLines(path, Counts.OrderByDescending(x => x.Value).Select(x => x.Value + " " + x.Key));
+}
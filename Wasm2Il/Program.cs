@@ -11,12 +11,79 @@ namespace Wasm2Il
             string run = null;
             string file = null;
             bool help = false;
+            var hosts = HostRegistry.CreateDefault();
+            bool intrinsics = false;
+            string? profileOut = null;
+            long? hotThreshold = null;
+            int? inlineBudget = null;
+            int? hotInlineBudget = null;
+            var policy = new MethodPolicy();
+            Profile? profile = null;
             for(int i = 0; i < args.Length; i++)
             {
                 if (args[i] == "--run")
                 {
                     run = args[i + 1];
                     i += 1;
+                }
+                else if (args[i] == "--dir")
+                {
+                    Wasi.Options.AddPreopen(args[i + 1]);
+                    i += 1;
+                }
+                else if (args[i] == "--host")
+                {
+                    hosts.Register(Assembly.LoadFrom(args[i + 1]));
+                    i += 1;
+                }
+                else if (args[i] == "--intrinsics")
+                    intrinsics = true;
+                else if (args[i] == "--profile-out")
+                {
+                    profileOut = args[i + 1];
+                    i += 1;
+                }
+                else if (args[i] == "--profile-in")
+                {
+                    profile = Profile.Load(args[i + 1]);
+                    i += 1;
+                }
+                else if (args[i] == "--hot-threshold")
+                {
+                    hotThreshold = long.Parse(args[i + 1]);
+                    i += 1;
+                }
+                else if (args[i] == "--inline-budget")
+                {
+                    inlineBudget = int.Parse(args[i + 1]);
+                    i += 1;
+                }
+                else if (args[i] == "--hot-inline-budget")
+                {
+                    hotInlineBudget = int.Parse(args[i + 1]);
+                    i += 1;
+                }
+                else if (args[i] == "--method-impl")
+                {
+                    policy.AddOverride(args[i + 1]);
+                    i += 1;
+                }
+                else if (args[i] == "--init-locals")
+                    policy.SkipLocalsInit = false;
+                else if (args[i] == "--memdir")
+                {
+                    Wasi.Options.AddMemoryPreopen(args[i + 1]);
+                    i += 1;
+                }
+                else if (args[i] == "--random-seed")
+                {
+                    Wasi.Options.RandomSeed = int.Parse(args[i + 1]);
+                    i += 1;
+                }
+                else if (args[i] == "--coarse-clock")
+                {
+                    Wasi.Options.CoarseClockInterval = TimeSpan.FromMilliseconds(double.Parse(args[i + 1]));
+                    i += 1;
                 }else if (args[i] == "--help")
                     help = true;
                 else
@@ -29,10 +96,21 @@ namespace Wasm2Il
                 throw new ArgumentException("File not specified", "--file");
             
             string dllName = Path.ChangeExtension(file, ".dll");
+            if (profile != null && hotThreshold != null)
+                profile.HotThreshold = hotThreshold.Value;
             if (file != null)
             {
                 var fstr = File.OpenRead(file);
-                new Transformer().Go(fstr, Path.GetFileNameWithoutExtension(file), dllName);
+                var transformer = new Transformer
+                {
+                    Hosts = hosts, Intrinsics = intrinsics, CountCalls = profileOut != null, Profile = profile,
+                    Policy = policy
+                };
+                if (inlineBudget != null)
+                    transformer.InlineBudget = inlineBudget.Value;
+                if (hotInlineBudget != null)
+                    transformer.HotInlineBudget = hotInlineBudget.Value;
+                transformer.Go(fstr, Path.GetFileNameWithoutExtension(file), dllName);
             }
 
             if (run != null)
@@ -40,7 +118,23 @@ namespace Wasm2Il
                 var asm = Assembly.LoadFile(Path.GetFullPath(dllName));
                 var m = asm.ExportedTypes.First().GetMethod(run);
                 var sw = Stopwatch.StartNew();
-                m.Invoke(null, null);
+                try
+                {
+                    m.Invoke(null, null);
+                }
+                catch (TargetInvocationException e) when (e.InnerException is Wasi.ProcExitException exit)
+                {
+                    Console.WriteLine("Exit code " + exit.ExitCode);
+                }
+                catch (Exception e) when (Traps.Translate(e) is { } trap)
+                {
+                    // the guest's buffered output came first.
+                    Wasi.FlushAll();
+                    Console.WriteLine("Trap: " + trap.Message);
+                }
+                Wasi.FlushAll();
+                if (profileOut != null)
+                    Profile.Collect(asm.ExportedTypes.First()).Save(profileOut);
                 Console.WriteLine("Done " + sw.ElapsedMilliseconds + "ms");
             }
         }
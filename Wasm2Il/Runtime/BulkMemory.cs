@@ -0,0 +1,45 @@
+using System.Runtime.CompilerServices;
+
+namespace Wasm2Il;
+
+/// <summary>
+/// Targets of the bulk memory instructions. The ranges are checked before anything is written, treating negative
+/// values as large unsigned ones, as the spec requires.
+/// The memory comes last, so compiled code can push it after the operands already on the stack.
+/// </summary>
+public static class BulkMemory
+{
+    /// <summary>
+    /// memory.copy. The ranges may overlap, which rules out a raw cpblk; Span.CopyTo is a vectorized memmove.
+    /// </summary>
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static void Copy(int dst, int src, int n, byte[] memory)
+    {
+        Traps.CheckBounds(memory, src, n);
+        Traps.CheckBounds(memory, dst, n);
+        memory.AsSpan(src, n).CopyTo(memory.AsSpan(dst, n));
+    }
+
+    /// <summary>
+    /// memory.fill, an initblk once the range is checked.
+    /// </summary>
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static void Fill(int dst, int value, int n, byte[] memory)
+    {
+        Traps.CheckBounds(memory, dst, n);
+        var span = memory.AsSpan(dst, n);
+        if (n > 0)
+            Unsafe.InitBlockUnaligned(ref span[0], (byte) value, (uint) n);
+    }
+
+    /// <summary>
+    /// memory.init from a passive data segment. Dropped and active segments are empty arrays.
+    /// </summary>
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static void Init(int dst, int src, int n, byte[] segment, byte[] memory)
+    {
+        Traps.CheckBounds(segment, src, n);
+        Traps.CheckBounds(memory, dst, n);
+        segment.AsSpan(src, n).CopyTo(memory.AsSpan(dst, n));
+    }
+}
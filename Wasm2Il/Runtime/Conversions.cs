@@ -0,0 +1,75 @@
+using System.Runtime.CompilerServices;
+
+namespace Wasm2Il;
+
+/// <summary>
+/// The float to int conversions. The trapping ones (trunc) throw an invalid conversion trap for NaN and an
+/// integer overflow trap for values out of range; the saturating ones (trunc_sat) turn NaN into 0 and clamp to
+/// the limits of the target type. Unsigned results are returned in the signed type, as wasm stores them.
+/// </summary>
+public static class Conversions
+{
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static int I32TruncF32S(float x) =>
+        x >= -2147483648f && x < 2147483648f ? (int) x : throw truncTrap(x);
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static int I32TruncF32U(float x) => x > -1f && x < 4294967296f ? (int) (uint) x : throw truncTrap(x);
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static int I32TruncF64S(double x) =>
+        x > -2147483649.0 && x < 2147483648.0 ? (int) x : throw truncTrap(x);
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static int I32TruncF64U(double x) => x > -1.0 && x < 4294967296.0 ? (int) (uint) x : throw truncTrap(x);
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static long I64TruncF32S(float x) =>
+        x >= -9223372036854775808f && x < 9223372036854775808f ? (long) x : throw truncTrap(x);
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static long I64TruncF32U(float x) =>
+        x > -1f && x < 18446744073709551616f ? (long) (ulong) x : throw truncTrap(x);
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static long I64TruncF64S(double x) =>
+        x >= -9223372036854775808.0 && x < 9223372036854775808.0 ? (long) x : throw truncTrap(x);
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static long I64TruncF64U(double x) =>
+        x > -1.0 && x < 18446744073709551616.0 ? (long) (ulong) x : throw truncTrap(x);
+
+    static WasmTrap truncTrap(double x) => double.IsNaN(x) ? Traps.InvalidConversion() : Traps.IntegerOverflow();
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static int I32TruncSatF32S(float x) =>
+        x >= 2147483648f ? int.MaxValue : x >= -2147483648f ? (int) x : x < 0 ? int.MinValue : 0;
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static int I32TruncSatF32U(float x) =>
+        x >= 4294967296f ? -1 : x > -1f ? (int) (uint) x : 0;
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static int I32TruncSatF64S(double x) =>
+        x >= 2147483648.0 ? int.MaxValue : x > -2147483649.0 ? (int) x : x < 0 ? int.MinValue : 0;
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static int I32TruncSatF64U(double x) =>
+        x >= 4294967296.0 ? -1 : x > -1.0 ? (int) (uint) x : 0;
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static long I64TruncSatF32S(float x) =>
+        x >= 9223372036854775808f ? long.MaxValue : x >= -9223372036854775808f ? (long) x : x < 0 ? long.MinValue : 0;
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static long I64TruncSatF32U(float x) =>
+        x >= 18446744073709551616f ? -1 : x > -1f ? (long) (ulong) x : 0;
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static long I64TruncSatF64S(double x) =>
+        x >= 9223372036854775808.0 ? long.MaxValue : x >= -9223372036854775808.0 ? (long) x : x < 0 ? long.MinValue : 0;
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static long I64TruncSatF64U(double x) =>
+        x >= 18446744073709551616.0 ? -1 : x > -1.0 ? (long) (ulong) x : 0;
+}
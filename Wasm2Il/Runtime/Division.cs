@@ -0,0 +1,61 @@
+using System.Runtime.CompilerServices;
+
+namespace Wasm2Il;
+
+/// <summary>
+/// Signed division and remainder for divisors that are not known constants. The CLR throws for
+/// MinValue % -1, where wasm returns 0, and its exceptions are not traps. The divisors needing care, 0 and -1,
+/// are caught with a single unsigned compare, so the common path is one predictable branch and the div.
+/// </summary>
+public static class Division
+{
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static int I32DivS(int x, int d)
+    {
+        if ((uint) (d + 1) <= 1)
+        {
+            if (d == 0) throw Traps.DivideByZero();
+            if (x == int.MinValue) throw Traps.IntegerOverflow();
+            return -x;
+        }
+
+        return x / d;
+    }
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static int I32RemS(int x, int d)
+    {
+        if ((uint) (d + 1) <= 1)
+        {
+            if (d == 0) throw Traps.DivideByZero();
+            return 0;
+        }
+
+        return x % d;
+    }
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static long I64DivS(long x, long d)
+    {
+        if ((ulong) (d + 1) <= 1)
+        {
+            if (d == 0) throw Traps.DivideByZero();
+            if (x == long.MinValue) throw Traps.IntegerOverflow();
+            return -x;
+        }
+
+        return x / d;
+    }
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static long I64RemS(long x, long d)
+    {
+        if ((ulong) (d + 1) <= 1)
+        {
+            if (d == 0) throw Traps.DivideByZero();
+            return 0;
+        }
+
+        return x % d;
+    }
+}
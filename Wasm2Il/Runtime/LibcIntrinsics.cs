@@ -0,0 +1,57 @@
+using System.Runtime.CompilerServices;
+
+namespace Wasm2Il;
+
+/// <summary>
+/// Replacements for libc routines compiled into a module, used when the transformer runs with intrinsics
+/// enabled. They work directly on linear memory with the vectorized span operations of the BCL. Out of bounds
+/// accesses trap, like the wasm loads and stores they replace.
+/// </summary>
+public static class LibcIntrinsics
+{
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static int memcpy(byte[] memory, int dst, int src, int n)
+    {
+        // CopyTo handles overlapping ranges, so memcpy and memmove are the same.
+        Traps.CheckBounds(memory, src, n);
+        Traps.CheckBounds(memory, dst, n);
+        memory.AsSpan(src, n).CopyTo(memory.AsSpan(dst, n));
+        return dst;
+    }
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static int memmove(byte[] memory, int dst, int src, int n) => memcpy(memory, dst, src, n);
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static int memset(byte[] memory, int dst, int c, int n)
+    {
+        Traps.CheckBounds(memory, dst, n);
+        memory.AsSpan(dst, n).Fill((byte) c);
+        return dst;
+    }
+
+    public static int memcmp(byte[] memory, int a, int b, int n)
+    {
+        Traps.CheckBounds(memory, a, n);
+        Traps.CheckBounds(memory, b, n);
+        var cmp = memory.AsSpan(a, n).SequenceCompareTo(memory.AsSpan(b, n));
+        return Math.Sign(cmp);
+    }
+
+    public static int strlen(byte[] memory, int s)
+    {
+        Traps.CheckBounds(memory, s, 0);
+        var len = memory.AsSpan(s).IndexOf((byte) 0);
+        if (len < 0)
+            throw Traps.OutOfBounds();
+        return len;
+    }
+
+    /// <summary>
+    /// Number of i32 parameters of each routine, all of which return an i32.
+    /// </summary>
+    public static readonly Dictionary<string, int> Signatures = new()
+    {
+        ["memcpy"] = 3, ["memmove"] = 3, ["memset"] = 3, ["memcmp"] = 3, ["strlen"] = 1
+    };
+}
@@ -0,0 +1,1822 @@
+using System.Numerics;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Runtime.Intrinsics;
+using System.Runtime.Intrinsics.Arm;
+using System.Runtime.Intrinsics.X86;
+
+namespace Wasm2Il;
+
+/// <summary>
+/// Implementations of the wasm SIMD instructions. A v128 is always a Vector128&lt;byte&gt; in compiled code and
+/// is reinterpreted per instruction. Every operation uses SSE or NEON where the hardware has it, the float
+/// compares included; float min/max are built from compares and blends to get wasm's NaN and signed zero rules.
+/// On hardware without either, the operations fall back to plain loops over the lanes.
+/// Method names are the instruction names in PascalCase, which is how the transformer finds them.
+/// Operands come first, then immediates (lane index, memory offset), then the linear memory.
+/// </summary>
+public static class Simd
+{
+    // the lanes of a vector, for the scalar fallbacks; they write their result over the first operand.
+    static Span<T> lanes<T>(ref Vector128<byte> v) where T : struct =>
+        MemoryMarshal.Cast<byte, T>(MemoryMarshal.CreateSpan(ref Unsafe.As<Vector128<byte>, byte>(ref v), 16));
+
+    // x where the lanes of mask are all ones, y where they are zero.
+    static Vector128<byte> select(Vector128<byte> mask, Vector128<byte> x, Vector128<byte> y)
+    {
+        if (Sse41.IsSupported) return Sse41.BlendVariable(y, x, mask);
+        return V128Bitselect(x, y, mask);
+    }
+
+    // wasm addresses are unsigned, and with the offset they can be past the range of an int.
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    static int effectiveAddress(int addr, uint offset, int size, byte[] memory)
+    {
+        var address = (ulong) (uint) addr + offset;
+        if (address + (uint) size > (ulong) memory.Length)
+            throw Traps.OutOfBounds();
+        return (int) address;
+    }
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static Vector128<byte> V128Load(int addr, uint offset, byte[] memory) =>
+        Unsafe.ReadUnaligned<Vector128<byte>>(ref memory[effectiveAddress(addr, offset, 16, memory)]);
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static void V128Store(int addr, Vector128<byte> value, uint offset, byte[] memory) =>
+        Unsafe.WriteUnaligned(ref memory[effectiveAddress(addr, offset, 16, memory)], value);
+
+    public static Vector128<byte> V128Load32Zero(int addr, uint offset, byte[] memory) =>
+        Vector128.CreateScalar(Unsafe.ReadUnaligned<uint>(ref memory[effectiveAddress(addr, offset, 4, memory)]))
+            .AsByte();
+
+    public static Vector128<byte> V128Load64Zero(int addr, uint offset, byte[] memory) =>
+        Vector128.CreateScalar(Unsafe.ReadUnaligned<ulong>(ref memory[effectiveAddress(addr, offset, 8, memory)]))
+            .AsByte();
+
+    // the extending loads read 64 bits and widen each lane.
+    public static Vector128<byte> V128Load8x8S(int addr, uint offset, byte[] memory) =>
+        I16x8ExtendLowI8x16S(load64(addr, offset, memory));
+
+    public static Vector128<byte> V128Load8x8U(int addr, uint offset, byte[] memory) =>
+        I16x8ExtendLowI8x16U(load64(addr, offset, memory));
+
+    public static Vector128<byte> V128Load16x4S(int addr, uint offset, byte[] memory) =>
+        I32x4ExtendLowI16x8S(load64(addr, offset, memory));
+
+    public static Vector128<byte> V128Load16x4U(int addr, uint offset, byte[] memory) =>
+        I32x4ExtendLowI16x8U(load64(addr, offset, memory));
+
+    public static Vector128<byte> V128Load32x2S(int addr, uint offset, byte[] memory) =>
+        I64x2ExtendLowI32x4S(load64(addr, offset, memory));
+
+    public static Vector128<byte> V128Load32x2U(int addr, uint offset, byte[] memory) =>
+        I64x2ExtendLowI32x4U(load64(addr, offset, memory));
+
+    static Vector128<byte> load64(int addr, uint offset, byte[] memory) =>
+        Vector128.CreateScalar(Unsafe.ReadUnaligned<ulong>(ref memory[effectiveAddress(addr, offset, 8, memory)]))
+            .AsByte();
+
+    public static Vector128<byte> V128Load8Splat(int addr, uint offset, byte[] memory) =>
+        Vector128.Create(memory[effectiveAddress(addr, offset, 1, memory)]);
+
+    public static Vector128<byte> V128Load16Splat(int addr, uint offset, byte[] memory) =>
+        Vector128.Create(Unsafe.ReadUnaligned<ushort>(ref memory[effectiveAddress(addr, offset, 2, memory)]))
+            .AsByte();
+
+    public static Vector128<byte> V128Load32Splat(int addr, uint offset, byte[] memory) =>
+        Vector128.Create(Unsafe.ReadUnaligned<uint>(ref memory[effectiveAddress(addr, offset, 4, memory)]))
+            .AsByte();
+
+    public static Vector128<byte> V128Load64Splat(int addr, uint offset, byte[] memory) =>
+        Vector128.Create(Unsafe.ReadUnaligned<ulong>(ref memory[effectiveAddress(addr, offset, 8, memory)]))
+            .AsByte();
+
+    // lane loads replace one lane of the vector operand, lane stores write one lane.
+    public static Vector128<byte> V128Load8Lane(int addr, Vector128<byte> a, int lane, uint offset, byte[] memory) =>
+        a.WithElement(lane, memory[effectiveAddress(addr, offset, 1, memory)]);
+
+    public static Vector128<byte> V128Load16Lane(int addr, Vector128<byte> a, int lane, uint offset, byte[] memory) =>
+        a.AsUInt16().WithElement(lane,
+            Unsafe.ReadUnaligned<ushort>(ref memory[effectiveAddress(addr, offset, 2, memory)])).AsByte();
+
+    public static Vector128<byte> V128Load32Lane(int addr, Vector128<byte> a, int lane, uint offset, byte[] memory) =>
+        a.AsUInt32().WithElement(lane,
+            Unsafe.ReadUnaligned<uint>(ref memory[effectiveAddress(addr, offset, 4, memory)])).AsByte();
+
+    public static Vector128<byte> V128Load64Lane(int addr, Vector128<byte> a, int lane, uint offset, byte[] memory) =>
+        a.AsUInt64().WithElement(lane,
+            Unsafe.ReadUnaligned<ulong>(ref memory[effectiveAddress(addr, offset, 8, memory)])).AsByte();
+
+    public static void V128Store8Lane(int addr, Vector128<byte> a, int lane, uint offset, byte[] memory) =>
+        memory[effectiveAddress(addr, offset, 1, memory)] = a.GetElement(lane);
+
+    public static void V128Store16Lane(int addr, Vector128<byte> a, int lane, uint offset, byte[] memory) =>
+        Unsafe.WriteUnaligned(ref memory[effectiveAddress(addr, offset, 2, memory)], a.AsUInt16().GetElement(lane));
+
+    public static void V128Store32Lane(int addr, Vector128<byte> a, int lane, uint offset, byte[] memory) =>
+        Unsafe.WriteUnaligned(ref memory[effectiveAddress(addr, offset, 4, memory)], a.AsUInt32().GetElement(lane));
+
+    public static void V128Store64Lane(int addr, Vector128<byte> a, int lane, uint offset, byte[] memory) =>
+        Unsafe.WriteUnaligned(ref memory[effectiveAddress(addr, offset, 8, memory)], a.AsUInt64().GetElement(lane));
+
+    public static Vector128<byte> V128Const(long lo, long hi) => Vector128.Create(lo, hi).AsByte();
+
+    public static Vector128<byte> I8x16Shuffle(Vector128<byte> a, Vector128<byte> b, Vector128<byte> indices)
+    {
+        // the lane indices are below 32. Those of b wrap around to >= 240 when a is looked up and the other way
+        // around, which both table lookups turn into zero.
+        var fromB = Vector128.Create((byte) 16);
+        if (Ssse3.IsSupported)
+            return Sse2.Or(Ssse3.Shuffle(a, Sse2.AddSaturate(indices, Vector128.Create((byte) 0x70))),
+                Ssse3.Shuffle(b, Sse2.Subtract(indices, fromB)));
+        if (AdvSimd.Arm64.IsSupported)
+            return AdvSimd.Or(AdvSimd.Arm64.VectorTableLookup(a, indices),
+                AdvSimd.Arm64.VectorTableLookup(b, AdvSimd.Subtract(indices, fromB)));
+        var x = lanes<byte>(ref a);
+        var y = lanes<byte>(ref b);
+        var l = lanes<byte>(ref indices);
+        for (int i = 0; i < 16; i++)
+            l[i] = l[i] < 16 ? x[l[i]] : y[l[i] - 16];
+        return indices;
+    }
+
+    public static Vector128<byte> I8x16Swizzle(Vector128<byte> a, Vector128<byte> s)
+    {
+        // pshufb zeroes lanes whose index has the top bit set; saturating add sends every index >= 16 there.
+        if (Ssse3.IsSupported)
+            return Ssse3.Shuffle(a, Sse2.AddSaturate(s, Vector128.Create((byte) 0x70)));
+        if (AdvSimd.Arm64.IsSupported)
+            return AdvSimd.Arm64.VectorTableLookup(a, s);
+        var x = lanes<byte>(ref a);
+        var l = lanes<byte>(ref s);
+        for (int i = 0; i < 16; i++)
+            l[i] = l[i] < 16 ? x[l[i]] : (byte) 0;
+        return s;
+    }
+
+    public static Vector128<byte> I8x16Splat(int x) => Vector128.Create((byte) x);
+    public static Vector128<byte> I16x8Splat(int x) => Vector128.Create((short) x).AsByte();
+    public static Vector128<byte> I32x4Splat(int x) => Vector128.Create(x).AsByte();
+    public static Vector128<byte> I64x2Splat(long x) => Vector128.Create(x).AsByte();
+    public static Vector128<byte> F32x4Splat(float x) => Vector128.Create(x).AsByte();
+    public static Vector128<byte> F64x2Splat(double x) => Vector128.Create(x).AsByte();
+
+    public static int I8x16ExtractLaneS(Vector128<byte> a, int lane) => a.AsSByte().GetElement(lane);
+    public static int I8x16ExtractLaneU(Vector128<byte> a, int lane) => a.GetElement(lane);
+    public static int I16x8ExtractLaneS(Vector128<byte> a, int lane) => a.AsInt16().GetElement(lane);
+    public static int I16x8ExtractLaneU(Vector128<byte> a, int lane) => a.AsUInt16().GetElement(lane);
+    public static int I32x4ExtractLane(Vector128<byte> a, int lane) => a.AsInt32().GetElement(lane);
+    public static long I64x2ExtractLane(Vector128<byte> a, int lane) => a.AsInt64().GetElement(lane);
+    public static float F32x4ExtractLane(Vector128<byte> a, int lane) => a.AsSingle().GetElement(lane);
+    public static double F64x2ExtractLane(Vector128<byte> a, int lane) => a.AsDouble().GetElement(lane);
+
+    public static Vector128<byte> I8x16ReplaceLane(Vector128<byte> a, int x, int lane) => a.WithElement(lane, (byte) x);
+
+    public static Vector128<byte> I16x8ReplaceLane(Vector128<byte> a, int x, int lane) =>
+        a.AsInt16().WithElement(lane, (short) x).AsByte();
+
+    public static Vector128<byte> I32x4ReplaceLane(Vector128<byte> a, int x, int lane) =>
+        a.AsInt32().WithElement(lane, x).AsByte();
+
+    public static Vector128<byte> I64x2ReplaceLane(Vector128<byte> a, long x, int lane) =>
+        a.AsInt64().WithElement(lane, x).AsByte();
+
+    public static Vector128<byte> F32x4ReplaceLane(Vector128<byte> a, float x, int lane) =>
+        a.AsSingle().WithElement(lane, x).AsByte();
+
+    public static Vector128<byte> F64x2ReplaceLane(Vector128<byte> a, double x, int lane) =>
+        a.AsDouble().WithElement(lane, x).AsByte();
+
+    // comparisons produce all ones or all zeros per lane.
+    public static Vector128<byte> I8x16Eq(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.CompareEqual(a, b);
+        if (AdvSimd.IsSupported) return AdvSimd.CompareEqual(a, b);
+        var x = lanes<byte>(ref a);
+        var y = lanes<byte>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = x[i] == y[i] ? byte.MaxValue : (byte) 0;
+        return a;
+    }
+
+    public static Vector128<byte> I8x16Ne(Vector128<byte> a, Vector128<byte> b) => V128Not(I8x16Eq(a, b));
+
+    // SSE only compares signed lanes; flipping the sign bits of both operands orders them as unsigned.
+    public static Vector128<byte> I8x16LtS(Vector128<byte> a, Vector128<byte> b) => I8x16GtS(b, a);
+    public static Vector128<byte> I8x16LtU(Vector128<byte> a, Vector128<byte> b) => I8x16GtU(b, a);
+
+    public static Vector128<byte> I8x16GtS(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.CompareGreaterThan(a.AsSByte(), b.AsSByte()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.CompareGreaterThan(a.AsSByte(), b.AsSByte()).AsByte();
+        var x = lanes<sbyte>(ref a);
+        var y = lanes<sbyte>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = (sbyte) (x[i] > y[i] ? -1 : 0);
+        return a;
+    }
+
+    public static Vector128<byte> I8x16GtU(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported)
+        {
+            var sign = Vector128.Create((byte) 0x80);
+            return Sse2.CompareGreaterThan(Sse2.Xor(a, sign).AsSByte(), Sse2.Xor(b, sign).AsSByte()).AsByte();
+        }
+
+        if (AdvSimd.IsSupported) return AdvSimd.CompareGreaterThan(a, b);
+        var x = lanes<byte>(ref a);
+        var y = lanes<byte>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = x[i] > y[i] ? byte.MaxValue : (byte) 0;
+        return a;
+    }
+
+    public static Vector128<byte> I8x16LeS(Vector128<byte> a, Vector128<byte> b) => V128Not(I8x16GtS(a, b));
+    public static Vector128<byte> I8x16LeU(Vector128<byte> a, Vector128<byte> b) => V128Not(I8x16GtU(a, b));
+    public static Vector128<byte> I8x16GeS(Vector128<byte> a, Vector128<byte> b) => V128Not(I8x16GtS(b, a));
+    public static Vector128<byte> I8x16GeU(Vector128<byte> a, Vector128<byte> b) => V128Not(I8x16GtU(b, a));
+
+    public static Vector128<byte> I16x8Eq(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.CompareEqual(a.AsInt16(), b.AsInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.CompareEqual(a.AsInt16(), b.AsInt16()).AsByte();
+        var x = lanes<short>(ref a);
+        var y = lanes<short>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = (short) (x[i] == y[i] ? -1 : 0);
+        return a;
+    }
+
+    public static Vector128<byte> I16x8Ne(Vector128<byte> a, Vector128<byte> b) => V128Not(I16x8Eq(a, b));
+
+    public static Vector128<byte> I16x8LtS(Vector128<byte> a, Vector128<byte> b) => I16x8GtS(b, a);
+    public static Vector128<byte> I16x8LtU(Vector128<byte> a, Vector128<byte> b) => I16x8GtU(b, a);
+
+    public static Vector128<byte> I16x8GtS(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.CompareGreaterThan(a.AsInt16(), b.AsInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.CompareGreaterThan(a.AsInt16(), b.AsInt16()).AsByte();
+        var x = lanes<short>(ref a);
+        var y = lanes<short>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = (short) (x[i] > y[i] ? -1 : 0);
+        return a;
+    }
+
+    public static Vector128<byte> I16x8GtU(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported)
+        {
+            var sign = Vector128.Create(short.MinValue);
+            return Sse2.CompareGreaterThan(Sse2.Xor(a.AsInt16(), sign), Sse2.Xor(b.AsInt16(), sign)).AsByte();
+        }
+
+        if (AdvSimd.IsSupported) return AdvSimd.CompareGreaterThan(a.AsUInt16(), b.AsUInt16()).AsByte();
+        var x = lanes<ushort>(ref a);
+        var y = lanes<ushort>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = x[i] > y[i] ? ushort.MaxValue : (ushort) 0;
+        return a;
+    }
+
+    public static Vector128<byte> I16x8LeS(Vector128<byte> a, Vector128<byte> b) => V128Not(I16x8GtS(a, b));
+    public static Vector128<byte> I16x8LeU(Vector128<byte> a, Vector128<byte> b) => V128Not(I16x8GtU(a, b));
+    public static Vector128<byte> I16x8GeS(Vector128<byte> a, Vector128<byte> b) => V128Not(I16x8GtS(b, a));
+    public static Vector128<byte> I16x8GeU(Vector128<byte> a, Vector128<byte> b) => V128Not(I16x8GtU(b, a));
+
+    public static Vector128<byte> I32x4Eq(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.CompareEqual(a.AsInt32(), b.AsInt32()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.CompareEqual(a.AsInt32(), b.AsInt32()).AsByte();
+        var x = lanes<int>(ref a);
+        var y = lanes<int>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = x[i] == y[i] ? -1 : 0;
+        return a;
+    }
+
+    public static Vector128<byte> I32x4Ne(Vector128<byte> a, Vector128<byte> b) => V128Not(I32x4Eq(a, b));
+
+    public static Vector128<byte> I32x4LtS(Vector128<byte> a, Vector128<byte> b) => I32x4GtS(b, a);
+
+    public static Vector128<byte> I32x4GtS(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.CompareGreaterThan(a.AsInt32(), b.AsInt32()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.CompareGreaterThan(a.AsInt32(), b.AsInt32()).AsByte();
+        var x = lanes<int>(ref a);
+        var y = lanes<int>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = x[i] > y[i] ? -1 : 0;
+        return a;
+    }
+
+    public static Vector128<byte> I32x4LtU(Vector128<byte> a, Vector128<byte> b) => I32x4GtU(b, a);
+
+    public static Vector128<byte> I32x4GtU(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported)
+        {
+            var sign = Vector128.Create(int.MinValue);
+            return Sse2.CompareGreaterThan(Sse2.Xor(a.AsInt32(), sign), Sse2.Xor(b.AsInt32(), sign)).AsByte();
+        }
+
+        if (AdvSimd.IsSupported) return AdvSimd.CompareGreaterThan(a.AsUInt32(), b.AsUInt32()).AsByte();
+        var x = lanes<uint>(ref a);
+        var y = lanes<uint>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = x[i] > y[i] ? uint.MaxValue : 0;
+        return a;
+    }
+
+    public static Vector128<byte> I32x4LeS(Vector128<byte> a, Vector128<byte> b) => V128Not(I32x4GtS(a, b));
+    public static Vector128<byte> I32x4LeU(Vector128<byte> a, Vector128<byte> b) => V128Not(I32x4GtU(a, b));
+    public static Vector128<byte> I32x4GeS(Vector128<byte> a, Vector128<byte> b) => V128Not(I32x4GtS(b, a));
+    public static Vector128<byte> I32x4GeU(Vector128<byte> a, Vector128<byte> b) => V128Not(I32x4GtU(b, a));
+
+    public static Vector128<byte> I64x2Eq(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse41.IsSupported) return Sse41.CompareEqual(a.AsInt64(), b.AsInt64()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.CompareEqual(a.AsInt64(), b.AsInt64()).AsByte();
+        var x = lanes<long>(ref a);
+        var y = lanes<long>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = x[i] == y[i] ? -1 : 0;
+        return a;
+    }
+
+    public static Vector128<byte> I64x2Ne(Vector128<byte> a, Vector128<byte> b) => V128Not(I64x2Eq(a, b));
+
+    public static Vector128<byte> I64x2LtS(Vector128<byte> a, Vector128<byte> b) => I64x2GtS(b, a);
+
+    public static Vector128<byte> I64x2GtS(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse42.IsSupported) return Sse42.CompareGreaterThan(a.AsInt64(), b.AsInt64()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.CompareGreaterThan(a.AsInt64(), b.AsInt64()).AsByte();
+        var x = lanes<long>(ref a);
+        var y = lanes<long>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = x[i] > y[i] ? -1 : 0;
+        return a;
+    }
+
+    public static Vector128<byte> I64x2LeS(Vector128<byte> a, Vector128<byte> b) => V128Not(I64x2GtS(a, b));
+    public static Vector128<byte> I64x2GeS(Vector128<byte> a, Vector128<byte> b) => V128Not(I64x2GtS(b, a));
+
+    // the float compares write their mask over the lanes they read, one lane at a time.
+    public static Vector128<byte> F32x4Eq(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse.IsSupported) return Sse.CompareEqual(a.AsSingle(), b.AsSingle()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.CompareEqual(a.AsSingle(), b.AsSingle()).AsByte();
+        var x = lanes<float>(ref a);
+        var y = lanes<float>(ref b);
+        var r = lanes<int>(ref a);
+        for (int i = 0; i < x.Length; i++)
+            r[i] = x[i] == y[i] ? -1 : 0;
+        return a;
+    }
+
+    // cmpneqps is true for unordered operands, like wasm's ne.
+    public static Vector128<byte> F32x4Ne(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse.IsSupported) return Sse.CompareNotEqual(a.AsSingle(), b.AsSingle()).AsByte();
+        return V128Not(F32x4Eq(a, b));
+    }
+
+    public static Vector128<byte> F32x4Lt(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse.IsSupported) return Sse.CompareLessThan(a.AsSingle(), b.AsSingle()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.CompareLessThan(a.AsSingle(), b.AsSingle()).AsByte();
+        var x = lanes<float>(ref a);
+        var y = lanes<float>(ref b);
+        var r = lanes<int>(ref a);
+        for (int i = 0; i < x.Length; i++)
+            r[i] = x[i] < y[i] ? -1 : 0;
+        return a;
+    }
+
+    public static Vector128<byte> F32x4Gt(Vector128<byte> a, Vector128<byte> b) => F32x4Lt(b, a);
+
+    public static Vector128<byte> F32x4Le(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse.IsSupported) return Sse.CompareLessThanOrEqual(a.AsSingle(), b.AsSingle()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.CompareLessThanOrEqual(a.AsSingle(), b.AsSingle()).AsByte();
+        var x = lanes<float>(ref a);
+        var y = lanes<float>(ref b);
+        var r = lanes<int>(ref a);
+        for (int i = 0; i < x.Length; i++)
+            r[i] = x[i] <= y[i] ? -1 : 0;
+        return a;
+    }
+
+    public static Vector128<byte> F32x4Ge(Vector128<byte> a, Vector128<byte> b) => F32x4Le(b, a);
+
+    public static Vector128<byte> F64x2Eq(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.CompareEqual(a.AsDouble(), b.AsDouble()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.CompareEqual(a.AsDouble(), b.AsDouble()).AsByte();
+        var x = lanes<double>(ref a);
+        var y = lanes<double>(ref b);
+        var r = lanes<long>(ref a);
+        for (int i = 0; i < x.Length; i++)
+            r[i] = x[i] == y[i] ? -1 : 0;
+        return a;
+    }
+
+    public static Vector128<byte> F64x2Ne(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.CompareNotEqual(a.AsDouble(), b.AsDouble()).AsByte();
+        return V128Not(F64x2Eq(a, b));
+    }
+
+    public static Vector128<byte> F64x2Lt(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.CompareLessThan(a.AsDouble(), b.AsDouble()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.CompareLessThan(a.AsDouble(), b.AsDouble()).AsByte();
+        var x = lanes<double>(ref a);
+        var y = lanes<double>(ref b);
+        var r = lanes<long>(ref a);
+        for (int i = 0; i < x.Length; i++)
+            r[i] = x[i] < y[i] ? -1 : 0;
+        return a;
+    }
+
+    public static Vector128<byte> F64x2Gt(Vector128<byte> a, Vector128<byte> b) => F64x2Lt(b, a);
+
+    public static Vector128<byte> F64x2Le(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.CompareLessThanOrEqual(a.AsDouble(), b.AsDouble()).AsByte();
+        if (AdvSimd.Arm64.IsSupported)
+            return AdvSimd.Arm64.CompareLessThanOrEqual(a.AsDouble(), b.AsDouble()).AsByte();
+        var x = lanes<double>(ref a);
+        var y = lanes<double>(ref b);
+        var r = lanes<long>(ref a);
+        for (int i = 0; i < x.Length; i++)
+            r[i] = x[i] <= y[i] ? -1 : 0;
+        return a;
+    }
+
+    public static Vector128<byte> F64x2Ge(Vector128<byte> a, Vector128<byte> b) => F64x2Le(b, a);
+
+    public static Vector128<byte> V128Not(Vector128<byte> a) => V128Xor(a, Vector128<byte>.AllBitsSet);
+
+    public static Vector128<byte> V128And(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.And(a, b);
+        if (AdvSimd.IsSupported) return AdvSimd.And(a, b);
+        var x = lanes<ulong>(ref a);
+        var y = lanes<ulong>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] &= y[i];
+        return a;
+    }
+
+    public static Vector128<byte> V128Andnot(Vector128<byte> a, Vector128<byte> b)
+    {
+        // Sse2.AndNot complements its first operand, wasm its second.
+        if (Sse2.IsSupported) return Sse2.AndNot(b, a);
+        if (AdvSimd.IsSupported) return AdvSimd.BitwiseClear(a, b);
+        var x = lanes<ulong>(ref a);
+        var y = lanes<ulong>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] &= ~y[i];
+        return a;
+    }
+
+    public static Vector128<byte> V128Or(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Or(a, b);
+        if (AdvSimd.IsSupported) return AdvSimd.Or(a, b);
+        var x = lanes<ulong>(ref a);
+        var y = lanes<ulong>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] |= y[i];
+        return a;
+    }
+
+    public static Vector128<byte> V128Xor(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Xor(a, b);
+        if (AdvSimd.IsSupported) return AdvSimd.Xor(a, b);
+        var x = lanes<ulong>(ref a);
+        var y = lanes<ulong>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] ^= y[i];
+        return a;
+    }
+
+    public static Vector128<byte> V128Bitselect(Vector128<byte> a, Vector128<byte> b, Vector128<byte> c)
+    {
+        if (AdvSimd.IsSupported) return AdvSimd.BitwiseSelect(c, a, b);
+        return V128Or(V128And(a, c), V128Andnot(b, c));
+    }
+
+    public static int V128AnyTrue(Vector128<byte> a)
+    {
+        var l = a.AsUInt64();
+        return (l.GetElement(0) | l.GetElement(1)) != 0 ? 1 : 0;
+    }
+
+    public static int I8x16AllTrue(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported) return Sse2.MoveMask(Sse2.CompareEqual(a, Vector128<byte>.Zero)) == 0 ? 1 : 0;
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.MinAcross(a).ToScalar() != 0 ? 1 : 0;
+        foreach (var x in lanes<byte>(ref a))
+            if (x == 0)
+                return 0;
+        return 1;
+    }
+
+    public static int I8x16Bitmask(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported) return Sse2.MoveMask(a);
+        var x = lanes<byte>(ref a);
+        int r = 0;
+        for (int i = 0; i < x.Length; i++)
+            r |= (x[i] >> 7) << i;
+        return r;
+    }
+
+    public static int I16x8AllTrue(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported)
+            return Sse2.MoveMask(Sse2.CompareEqual(a.AsInt16(), Vector128<short>.Zero).AsByte()) == 0 ? 1 : 0;
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.MinAcross(a.AsUInt16()).ToScalar() != 0 ? 1 : 0;
+        foreach (var x in lanes<short>(ref a))
+            if (x == 0)
+                return 0;
+        return 1;
+    }
+
+    // packing keeps the sign of each lane, so one byte mask holds the eight sign bits.
+    public static int I16x8Bitmask(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported) return Sse2.MoveMask(Sse2.PackSignedSaturate(a.AsInt16(), a.AsInt16())) & 0xFF;
+        var x = lanes<ushort>(ref a);
+        int r = 0;
+        for (int i = 0; i < x.Length; i++)
+            r |= (x[i] >> 15) << i;
+        return r;
+    }
+
+    public static int I32x4AllTrue(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported)
+            return Sse2.MoveMask(Sse2.CompareEqual(a.AsInt32(), Vector128<int>.Zero).AsByte()) == 0 ? 1 : 0;
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.MinAcross(a.AsUInt32()).ToScalar() != 0 ? 1 : 0;
+        foreach (var x in lanes<int>(ref a))
+            if (x == 0)
+                return 0;
+        return 1;
+    }
+
+    public static int I32x4Bitmask(Vector128<byte> a)
+    {
+        if (Sse.IsSupported) return Sse.MoveMask(a.AsSingle());
+        var x = lanes<uint>(ref a);
+        int r = 0;
+        for (int i = 0; i < x.Length; i++)
+            r |= (int) (x[i] >> 31) << i;
+        return r;
+    }
+
+    public static int I64x2AllTrue(Vector128<byte> a)
+    {
+        var l = a.AsUInt64();
+        return l.GetElement(0) != 0 && l.GetElement(1) != 0 ? 1 : 0;
+    }
+
+    public static int I64x2Bitmask(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported) return Sse2.MoveMask(a.AsDouble());
+        var x = lanes<ulong>(ref a);
+        return (int) (x[0] >> 63) | (int) (x[1] >> 63) << 1;
+    }
+
+    public static Vector128<byte> I8x16Add(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Add(a, b);
+        if (AdvSimd.IsSupported) return AdvSimd.Add(a, b);
+        var x = lanes<byte>(ref a);
+        var y = lanes<byte>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] += y[i];
+        return a;
+    }
+
+    public static Vector128<byte> I8x16Sub(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Subtract(a, b);
+        if (AdvSimd.IsSupported) return AdvSimd.Subtract(a, b);
+        var x = lanes<byte>(ref a);
+        var y = lanes<byte>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] -= y[i];
+        return a;
+    }
+
+    public static Vector128<byte> I8x16Abs(Vector128<byte> a)
+    {
+        if (Ssse3.IsSupported) return Ssse3.Abs(a.AsSByte());
+        if (AdvSimd.IsSupported) return AdvSimd.Abs(a.AsSByte());
+        foreach (ref var x in lanes<sbyte>(ref a))
+            x = (sbyte) Math.Abs((int) x);
+        return a;
+    }
+
+    public static Vector128<byte> I8x16Neg(Vector128<byte> a) => I8x16Sub(Vector128<byte>.Zero, a);
+
+    public static Vector128<byte> I8x16Popcnt(Vector128<byte> a)
+    {
+        // pshufb looks up the bit count of each nibble in a 16 entry table.
+        if (Ssse3.IsSupported)
+        {
+            var counts = Vector128.Create((byte) 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+            var nibble = Vector128.Create((byte) 0x0F);
+            var lo = Sse2.And(a, nibble);
+            var hi = Sse2.And(Sse2.ShiftRightLogical(a.AsUInt16(), 4).AsByte(), nibble);
+            return Sse2.Add(Ssse3.Shuffle(counts, lo), Ssse3.Shuffle(counts, hi));
+        }
+
+        if (AdvSimd.IsSupported) return AdvSimd.PopCount(a);
+        foreach (ref var x in lanes<byte>(ref a))
+            x = (byte) BitOperations.PopCount(x);
+        return a;
+    }
+
+    public static Vector128<byte> I8x16NarrowI16x8S(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.PackSignedSaturate(a.AsInt16(), b.AsInt16()).AsByte();
+        if (AdvSimd.IsSupported)
+            return AdvSimd.ExtractNarrowingSaturateUpper(AdvSimd.ExtractNarrowingSaturateLower(a.AsInt16()),
+                b.AsInt16()).AsByte();
+        var x = lanes<short>(ref a);
+        var y = lanes<short>(ref b);
+        var r = new Vector128<byte>();
+        var l = lanes<sbyte>(ref r);
+        for (int i = 0; i < 8; i++)
+        {
+            l[i] = (sbyte) Math.Clamp(x[i], sbyte.MinValue, sbyte.MaxValue);
+            l[i + 8] = (sbyte) Math.Clamp(y[i], sbyte.MinValue, sbyte.MaxValue);
+        }
+
+        return r;
+    }
+
+    public static Vector128<byte> I8x16NarrowI16x8U(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.PackUnsignedSaturate(a.AsInt16(), b.AsInt16());
+        if (AdvSimd.IsSupported)
+            return AdvSimd.ExtractNarrowingSaturateUnsignedUpper(
+                AdvSimd.ExtractNarrowingSaturateUnsignedLower(a.AsInt16()), b.AsInt16());
+        var x = lanes<short>(ref a);
+        var y = lanes<short>(ref b);
+        var r = new Vector128<byte>();
+        var l = lanes<byte>(ref r);
+        for (int i = 0; i < 8; i++)
+        {
+            l[i] = (byte) Math.Clamp(x[i], byte.MinValue, byte.MaxValue);
+            l[i + 8] = (byte) Math.Clamp(y[i], byte.MinValue, byte.MaxValue);
+        }
+
+        return r;
+    }
+
+    // SSE has no byte shifts: the 16 bit shifts move bits across the lanes, which the mask clears again.
+    public static Vector128<byte> I8x16Shl(Vector128<byte> a, int n)
+    {
+        n &= 7;
+        if (Sse2.IsSupported)
+            return Sse2.And(Sse2.ShiftLeftLogical(a.AsInt16(), (byte) n).AsByte(),
+                Vector128.Create((byte) (0xFF << n)));
+        if (AdvSimd.IsSupported) return AdvSimd.ShiftLogical(a, Vector128.Create((sbyte) n));
+        foreach (ref var x in lanes<byte>(ref a))
+            x <<= n;
+        return a;
+    }
+
+    public static Vector128<byte> I8x16ShrS(Vector128<byte> a, int n)
+    {
+        n &= 7;
+        // each byte is doubled into a 16 bit lane, shifted down with its sign and packed back.
+        if (Sse2.IsSupported)
+            return Sse2.PackSignedSaturate(Sse2.ShiftRightArithmetic(Sse2.UnpackLow(a, a).AsInt16(), (byte) (n + 8)),
+                Sse2.ShiftRightArithmetic(Sse2.UnpackHigh(a, a).AsInt16(), (byte) (n + 8))).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.ShiftArithmetic(a.AsSByte(), Vector128.Create((sbyte) -n)).AsByte();
+        foreach (ref var x in lanes<sbyte>(ref a))
+            x >>= n;
+        return a;
+    }
+
+    public static Vector128<byte> I8x16ShrU(Vector128<byte> a, int n)
+    {
+        n &= 7;
+        if (Sse2.IsSupported)
+            return Sse2.And(Sse2.ShiftRightLogical(a.AsInt16(), (byte) n).AsByte(),
+                Vector128.Create((byte) (0xFF >> n)));
+        if (AdvSimd.IsSupported) return AdvSimd.ShiftLogical(a, Vector128.Create((sbyte) -n));
+        foreach (ref var x in lanes<byte>(ref a))
+            x >>= n;
+        return a;
+    }
+
+    public static Vector128<byte> I8x16AddSatS(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.AddSaturate(a.AsSByte(), b.AsSByte()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.AddSaturate(a.AsSByte(), b.AsSByte()).AsByte();
+        var x = lanes<sbyte>(ref a);
+        var y = lanes<sbyte>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = (sbyte) Math.Clamp(x[i] + y[i], sbyte.MinValue, sbyte.MaxValue);
+        return a;
+    }
+
+    public static Vector128<byte> I8x16AddSatU(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.AddSaturate(a, b);
+        if (AdvSimd.IsSupported) return AdvSimd.AddSaturate(a, b);
+        var x = lanes<byte>(ref a);
+        var y = lanes<byte>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = (byte) Math.Min(x[i] + y[i], byte.MaxValue);
+        return a;
+    }
+
+    public static Vector128<byte> I8x16SubSatS(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.SubtractSaturate(a.AsSByte(), b.AsSByte()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.SubtractSaturate(a.AsSByte(), b.AsSByte()).AsByte();
+        var x = lanes<sbyte>(ref a);
+        var y = lanes<sbyte>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = (sbyte) Math.Clamp(x[i] - y[i], sbyte.MinValue, sbyte.MaxValue);
+        return a;
+    }
+
+    public static Vector128<byte> I8x16SubSatU(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.SubtractSaturate(a, b);
+        if (AdvSimd.IsSupported) return AdvSimd.SubtractSaturate(a, b);
+        var x = lanes<byte>(ref a);
+        var y = lanes<byte>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = (byte) Math.Max(x[i] - y[i], 0);
+        return a;
+    }
+
+    public static Vector128<byte> I8x16MinS(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse41.IsSupported) return Sse41.Min(a.AsSByte(), b.AsSByte()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Min(a.AsSByte(), b.AsSByte()).AsByte();
+        var x = lanes<sbyte>(ref a);
+        var y = lanes<sbyte>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = Math.Min(x[i], y[i]);
+        return a;
+    }
+
+    public static Vector128<byte> I8x16MinU(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Min(a, b);
+        if (AdvSimd.IsSupported) return AdvSimd.Min(a, b);
+        var x = lanes<byte>(ref a);
+        var y = lanes<byte>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = Math.Min(x[i], y[i]);
+        return a;
+    }
+
+    public static Vector128<byte> I8x16MaxS(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse41.IsSupported) return Sse41.Max(a.AsSByte(), b.AsSByte()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Max(a.AsSByte(), b.AsSByte()).AsByte();
+        var x = lanes<sbyte>(ref a);
+        var y = lanes<sbyte>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = Math.Max(x[i], y[i]);
+        return a;
+    }
+
+    public static Vector128<byte> I8x16MaxU(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Max(a, b);
+        if (AdvSimd.IsSupported) return AdvSimd.Max(a, b);
+        var x = lanes<byte>(ref a);
+        var y = lanes<byte>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = Math.Max(x[i], y[i]);
+        return a;
+    }
+
+    // pavgb rounds up like wasm's avgr_u.
+    public static Vector128<byte> I8x16AvgrU(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Average(a, b);
+        if (AdvSimd.IsSupported) return AdvSimd.FusedAddRoundedHalving(a, b);
+        var x = lanes<byte>(ref a);
+        var y = lanes<byte>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = (byte) ((x[i] + y[i] + 1) >> 1);
+        return a;
+    }
+
+    // pmaddubsw multiplies unsigned bytes of its first operand with signed bytes of its second and adds pairs;
+    // multiplying by one leaves the pairwise sum.
+    public static Vector128<byte> I16x8ExtaddPairwiseI8x16S(Vector128<byte> a)
+    {
+        if (Ssse3.IsSupported) return Ssse3.MultiplyAddAdjacent(Vector128.Create((byte) 1), a.AsSByte()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.AddPairwiseWidening(a.AsSByte()).AsByte();
+        var x = lanes<sbyte>(ref a);
+        var r = new Vector128<byte>();
+        var l = lanes<short>(ref r);
+        for (int i = 0; i < l.Length; i++)
+            l[i] = (short) (x[2 * i] + x[2 * i + 1]);
+        return r;
+    }
+
+    public static Vector128<byte> I16x8ExtaddPairwiseI8x16U(Vector128<byte> a)
+    {
+        if (Ssse3.IsSupported) return Ssse3.MultiplyAddAdjacent(a, Vector128.Create((sbyte) 1)).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.AddPairwiseWidening(a).AsByte();
+        var x = lanes<byte>(ref a);
+        var r = new Vector128<byte>();
+        var l = lanes<short>(ref r);
+        for (int i = 0; i < l.Length; i++)
+            l[i] = (short) (x[2 * i] + x[2 * i + 1]);
+        return r;
+    }
+
+    public static Vector128<byte> I16x8Abs(Vector128<byte> a)
+    {
+        if (Ssse3.IsSupported) return Ssse3.Abs(a.AsInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Abs(a.AsInt16()).AsByte();
+        foreach (ref var x in lanes<short>(ref a))
+            x = (short) Math.Abs((int) x);
+        return a;
+    }
+
+    public static Vector128<byte> I16x8Neg(Vector128<byte> a) => I16x8Sub(Vector128<byte>.Zero, a);
+
+    // pmulhrsw computes the same rounded product but wraps -1 * -1 around to -1 instead of saturating; that is the
+    // only product giving short.MinValue, so those lanes are flipped to short.MaxValue.
+    public static Vector128<byte> I16x8Q15mulrSatS(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Ssse3.IsSupported)
+        {
+            var r = Ssse3.MultiplyHighRoundScale(a.AsInt16(), b.AsInt16());
+            return Sse2.Xor(r, Sse2.CompareEqual(r, Vector128.Create(short.MinValue))).AsByte();
+        }
+
+        if (AdvSimd.IsSupported) return AdvSimd.MultiplyRoundedDoublingSaturateHigh(a.AsInt16(), b.AsInt16()).AsByte();
+        var x = lanes<short>(ref a);
+        var y = lanes<short>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = (short) Math.Min((x[i] * y[i] + 0x4000) >> 15, short.MaxValue);
+        return a;
+    }
+
+    public static Vector128<byte> I16x8NarrowI32x4S(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.PackSignedSaturate(a.AsInt32(), b.AsInt32()).AsByte();
+        if (AdvSimd.IsSupported)
+            return AdvSimd.ExtractNarrowingSaturateUpper(AdvSimd.ExtractNarrowingSaturateLower(a.AsInt32()),
+                b.AsInt32()).AsByte();
+        var x = lanes<int>(ref a);
+        var y = lanes<int>(ref b);
+        var r = new Vector128<byte>();
+        var l = lanes<short>(ref r);
+        for (int i = 0; i < 4; i++)
+        {
+            l[i] = (short) Math.Clamp(x[i], short.MinValue, short.MaxValue);
+            l[i + 4] = (short) Math.Clamp(y[i], short.MinValue, short.MaxValue);
+        }
+
+        return r;
+    }
+
+    public static Vector128<byte> I16x8NarrowI32x4U(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse41.IsSupported) return Sse41.PackUnsignedSaturate(a.AsInt32(), b.AsInt32()).AsByte();
+        if (AdvSimd.IsSupported)
+            return AdvSimd.ExtractNarrowingSaturateUnsignedUpper(
+                AdvSimd.ExtractNarrowingSaturateUnsignedLower(a.AsInt32()), b.AsInt32()).AsByte();
+        var x = lanes<int>(ref a);
+        var y = lanes<int>(ref b);
+        var r = new Vector128<byte>();
+        var l = lanes<ushort>(ref r);
+        for (int i = 0; i < 4; i++)
+        {
+            l[i] = (ushort) Math.Clamp(x[i], ushort.MinValue, ushort.MaxValue);
+            l[i + 4] = (ushort) Math.Clamp(y[i], ushort.MinValue, ushort.MaxValue);
+        }
+
+        return r;
+    }
+
+    // the high variants move the upper half down and widen it like the low half.
+    public static Vector128<byte> I16x8ExtendLowI8x16S(Vector128<byte> a)
+    {
+        if (Sse41.IsSupported) return Sse41.ConvertToVector128Int16(a.AsSByte()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.SignExtendWideningLower(a.AsSByte().GetLower()).AsByte();
+        var x = lanes<sbyte>(ref a);
+        var r = new Vector128<byte>();
+        var l = lanes<short>(ref r);
+        for (int i = 0; i < l.Length; i++)
+            l[i] = x[i];
+        return r;
+    }
+
+    public static Vector128<byte> I16x8ExtendHighI8x16S(Vector128<byte> a) => I16x8ExtendLowI8x16S(upperHalf(a));
+
+    public static Vector128<byte> I16x8ExtendLowI8x16U(Vector128<byte> a)
+    {
+        if (Sse41.IsSupported) return Sse41.ConvertToVector128Int16(a).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.ZeroExtendWideningLower(a.GetLower()).AsByte();
+        var x = lanes<byte>(ref a);
+        var r = new Vector128<byte>();
+        var l = lanes<ushort>(ref r);
+        for (int i = 0; i < l.Length; i++)
+            l[i] = x[i];
+        return r;
+    }
+
+    public static Vector128<byte> I16x8ExtendHighI8x16U(Vector128<byte> a) => I16x8ExtendLowI8x16U(upperHalf(a));
+
+    static Vector128<byte> upperHalf(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported) return Sse2.ShiftRightLogical128BitLane(a, 8);
+        return Vector128.CreateScalar(a.AsUInt64().GetElement(1)).AsByte();
+    }
+
+    public static Vector128<byte> I16x8Shl(Vector128<byte> a, int n)
+    {
+        if (Sse2.IsSupported) return Sse2.ShiftLeftLogical(a.AsInt16(), (byte) (n & 15)).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.ShiftLogical(a.AsInt16(), Vector128.Create((short) (n & 15))).AsByte();
+        foreach (ref var x in lanes<short>(ref a))
+            x <<= n & 15;
+        return a;
+    }
+
+    public static Vector128<byte> I16x8ShrS(Vector128<byte> a, int n)
+    {
+        if (Sse2.IsSupported) return Sse2.ShiftRightArithmetic(a.AsInt16(), (byte) (n & 15)).AsByte();
+        if (AdvSimd.IsSupported)
+            return AdvSimd.ShiftArithmetic(a.AsInt16(), Vector128.Create((short) -(n & 15))).AsByte();
+        foreach (ref var x in lanes<short>(ref a))
+            x >>= n & 15;
+        return a;
+    }
+
+    public static Vector128<byte> I16x8ShrU(Vector128<byte> a, int n)
+    {
+        if (Sse2.IsSupported) return Sse2.ShiftRightLogical(a.AsInt16(), (byte) (n & 15)).AsByte();
+        if (AdvSimd.IsSupported)
+            return AdvSimd.ShiftLogical(a.AsUInt16(), Vector128.Create((short) -(n & 15))).AsByte();
+        foreach (ref var x in lanes<ushort>(ref a))
+            x >>= n & 15;
+        return a;
+    }
+
+    public static Vector128<byte> I16x8Add(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Add(a.AsInt16(), b.AsInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Add(a.AsInt16(), b.AsInt16()).AsByte();
+        var x = lanes<short>(ref a);
+        var y = lanes<short>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] += y[i];
+        return a;
+    }
+
+    public static Vector128<byte> I16x8Sub(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Subtract(a.AsInt16(), b.AsInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Subtract(a.AsInt16(), b.AsInt16()).AsByte();
+        var x = lanes<short>(ref a);
+        var y = lanes<short>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] -= y[i];
+        return a;
+    }
+
+    public static Vector128<byte> I16x8Mul(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.MultiplyLow(a.AsInt16(), b.AsInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Multiply(a.AsInt16(), b.AsInt16()).AsByte();
+        var x = lanes<short>(ref a);
+        var y = lanes<short>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] *= y[i];
+        return a;
+    }
+
+    public static Vector128<byte> I16x8AddSatS(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.AddSaturate(a.AsInt16(), b.AsInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.AddSaturate(a.AsInt16(), b.AsInt16()).AsByte();
+        var x = lanes<short>(ref a);
+        var y = lanes<short>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = (short) Math.Clamp(x[i] + y[i], short.MinValue, short.MaxValue);
+        return a;
+    }
+
+    public static Vector128<byte> I16x8AddSatU(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.AddSaturate(a.AsUInt16(), b.AsUInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.AddSaturate(a.AsUInt16(), b.AsUInt16()).AsByte();
+        var x = lanes<ushort>(ref a);
+        var y = lanes<ushort>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = (ushort) Math.Min(x[i] + y[i], ushort.MaxValue);
+        return a;
+    }
+
+    public static Vector128<byte> I16x8SubSatS(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.SubtractSaturate(a.AsInt16(), b.AsInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.SubtractSaturate(a.AsInt16(), b.AsInt16()).AsByte();
+        var x = lanes<short>(ref a);
+        var y = lanes<short>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = (short) Math.Clamp(x[i] - y[i], short.MinValue, short.MaxValue);
+        return a;
+    }
+
+    public static Vector128<byte> I16x8SubSatU(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.SubtractSaturate(a.AsUInt16(), b.AsUInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.SubtractSaturate(a.AsUInt16(), b.AsUInt16()).AsByte();
+        var x = lanes<ushort>(ref a);
+        var y = lanes<ushort>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = (ushort) Math.Max(x[i] - y[i], 0);
+        return a;
+    }
+
+    public static Vector128<byte> I16x8MinS(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Min(a.AsInt16(), b.AsInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Min(a.AsInt16(), b.AsInt16()).AsByte();
+        var x = lanes<short>(ref a);
+        var y = lanes<short>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = Math.Min(x[i], y[i]);
+        return a;
+    }
+
+    public static Vector128<byte> I16x8MinU(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse41.IsSupported) return Sse41.Min(a.AsUInt16(), b.AsUInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Min(a.AsUInt16(), b.AsUInt16()).AsByte();
+        var x = lanes<ushort>(ref a);
+        var y = lanes<ushort>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = Math.Min(x[i], y[i]);
+        return a;
+    }
+
+    public static Vector128<byte> I16x8MaxS(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Max(a.AsInt16(), b.AsInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Max(a.AsInt16(), b.AsInt16()).AsByte();
+        var x = lanes<short>(ref a);
+        var y = lanes<short>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = Math.Max(x[i], y[i]);
+        return a;
+    }
+
+    public static Vector128<byte> I16x8MaxU(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse41.IsSupported) return Sse41.Max(a.AsUInt16(), b.AsUInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Max(a.AsUInt16(), b.AsUInt16()).AsByte();
+        var x = lanes<ushort>(ref a);
+        var y = lanes<ushort>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = Math.Max(x[i], y[i]);
+        return a;
+    }
+
+    public static Vector128<byte> I16x8AvgrU(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Average(a.AsUInt16(), b.AsUInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.FusedAddRoundedHalving(a.AsUInt16(), b.AsUInt16()).AsByte();
+        var x = lanes<ushort>(ref a);
+        var y = lanes<ushort>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = (ushort) ((x[i] + y[i] + 1) >> 1);
+        return a;
+    }
+
+    // the extended multiplies widen both halves first, so the products cannot overflow.
+    public static Vector128<byte> I16x8ExtmulLowI8x16S(Vector128<byte> a, Vector128<byte> b) =>
+        I16x8Mul(I16x8ExtendLowI8x16S(a), I16x8ExtendLowI8x16S(b));
+
+    public static Vector128<byte> I16x8ExtmulHighI8x16S(Vector128<byte> a, Vector128<byte> b) =>
+        I16x8Mul(I16x8ExtendHighI8x16S(a), I16x8ExtendHighI8x16S(b));
+
+    public static Vector128<byte> I16x8ExtmulLowI8x16U(Vector128<byte> a, Vector128<byte> b) =>
+        I16x8Mul(I16x8ExtendLowI8x16U(a), I16x8ExtendLowI8x16U(b));
+
+    public static Vector128<byte> I16x8ExtmulHighI8x16U(Vector128<byte> a, Vector128<byte> b) =>
+        I16x8Mul(I16x8ExtendHighI8x16U(a), I16x8ExtendHighI8x16U(b));
+
+    public static Vector128<byte> I32x4ExtaddPairwiseI16x8S(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported) return Sse2.MultiplyAddAdjacent(a.AsInt16(), Vector128.Create((short) 1)).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.AddPairwiseWidening(a.AsInt16()).AsByte();
+        var x = lanes<short>(ref a);
+        var r = new Vector128<byte>();
+        var l = lanes<int>(ref r);
+        for (int i = 0; i < l.Length; i++)
+            l[i] = x[2 * i] + x[2 * i + 1];
+        return r;
+    }
+
+    // pmaddwd is signed only: biasing the lanes by -32768 makes them signed, the sums are corrected by 65536.
+    public static Vector128<byte> I32x4ExtaddPairwiseI16x8U(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported)
+            return Sse2.Add(Sse2.MultiplyAddAdjacent(Sse2.Xor(a.AsInt16(), Vector128.Create(short.MinValue)),
+                Vector128.Create((short) 1)), Vector128.Create(0x10000)).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.AddPairwiseWidening(a.AsUInt16()).AsByte();
+        var x = lanes<ushort>(ref a);
+        var r = new Vector128<byte>();
+        var l = lanes<int>(ref r);
+        for (int i = 0; i < l.Length; i++)
+            l[i] = x[2 * i] + x[2 * i + 1];
+        return r;
+    }
+
+    public static Vector128<byte> I32x4Abs(Vector128<byte> a)
+    {
+        if (Ssse3.IsSupported) return Ssse3.Abs(a.AsInt32()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Abs(a.AsInt32()).AsByte();
+        foreach (ref var x in lanes<int>(ref a))
+            x = x < 0 ? -x : x;
+        return a;
+    }
+
+    public static Vector128<byte> I32x4Neg(Vector128<byte> a) => I32x4Sub(Vector128<byte>.Zero, a);
+
+    public static Vector128<byte> I32x4ExtendLowI16x8S(Vector128<byte> a)
+    {
+        if (Sse41.IsSupported) return Sse41.ConvertToVector128Int32(a.AsInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.SignExtendWideningLower(a.AsInt16().GetLower()).AsByte();
+        var x = lanes<short>(ref a);
+        var r = new Vector128<byte>();
+        var l = lanes<int>(ref r);
+        for (int i = 0; i < l.Length; i++)
+            l[i] = x[i];
+        return r;
+    }
+
+    public static Vector128<byte> I32x4ExtendHighI16x8S(Vector128<byte> a) => I32x4ExtendLowI16x8S(upperHalf(a));
+
+    public static Vector128<byte> I32x4ExtendLowI16x8U(Vector128<byte> a)
+    {
+        if (Sse41.IsSupported) return Sse41.ConvertToVector128Int32(a.AsUInt16()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.ZeroExtendWideningLower(a.AsUInt16().GetLower()).AsByte();
+        var x = lanes<ushort>(ref a);
+        var r = new Vector128<byte>();
+        var l = lanes<int>(ref r);
+        for (int i = 0; i < l.Length; i++)
+            l[i] = x[i];
+        return r;
+    }
+
+    public static Vector128<byte> I32x4ExtendHighI16x8U(Vector128<byte> a) => I32x4ExtendLowI16x8U(upperHalf(a));
+
+    // NEON shifts by a signed per lane count, negative counts shift right.
+    public static Vector128<byte> I32x4Shl(Vector128<byte> a, int n)
+    {
+        if (Sse2.IsSupported) return Sse2.ShiftLeftLogical(a.AsInt32(), (byte) (n & 31)).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.ShiftLogical(a.AsInt32(), Vector128.Create(n & 31)).AsByte();
+        foreach (ref var x in lanes<int>(ref a))
+            x <<= n;
+        return a;
+    }
+
+    public static Vector128<byte> I32x4ShrS(Vector128<byte> a, int n)
+    {
+        if (Sse2.IsSupported) return Sse2.ShiftRightArithmetic(a.AsInt32(), (byte) (n & 31)).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.ShiftArithmetic(a.AsInt32(), Vector128.Create(-(n & 31))).AsByte();
+        foreach (ref var x in lanes<int>(ref a))
+            x >>= n;
+        return a;
+    }
+
+    public static Vector128<byte> I32x4ShrU(Vector128<byte> a, int n)
+    {
+        if (Sse2.IsSupported) return Sse2.ShiftRightLogical(a.AsInt32(), (byte) (n & 31)).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.ShiftLogical(a.AsUInt32(), Vector128.Create(-(n & 31))).AsByte();
+        foreach (ref var x in lanes<uint>(ref a))
+            x >>= n;
+        return a;
+    }
+
+    public static Vector128<byte> I32x4Add(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Add(a.AsInt32(), b.AsInt32()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Add(a.AsInt32(), b.AsInt32()).AsByte();
+        var x = lanes<int>(ref a);
+        var y = lanes<int>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] += y[i];
+        return a;
+    }
+
+    public static Vector128<byte> I32x4Sub(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Subtract(a.AsInt32(), b.AsInt32()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Subtract(a.AsInt32(), b.AsInt32()).AsByte();
+        var x = lanes<int>(ref a);
+        var y = lanes<int>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] -= y[i];
+        return a;
+    }
+
+    public static Vector128<byte> I32x4Mul(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse41.IsSupported) return Sse41.MultiplyLow(a.AsInt32(), b.AsInt32()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Multiply(a.AsInt32(), b.AsInt32()).AsByte();
+        var x = lanes<int>(ref a);
+        var y = lanes<int>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] *= y[i];
+        return a;
+    }
+
+    public static Vector128<byte> I32x4MinS(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse41.IsSupported) return Sse41.Min(a.AsInt32(), b.AsInt32()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Min(a.AsInt32(), b.AsInt32()).AsByte();
+        var x = lanes<int>(ref a);
+        var y = lanes<int>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = Math.Min(x[i], y[i]);
+        return a;
+    }
+
+    public static Vector128<byte> I32x4MaxS(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse41.IsSupported) return Sse41.Max(a.AsInt32(), b.AsInt32()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Max(a.AsInt32(), b.AsInt32()).AsByte();
+        var x = lanes<int>(ref a);
+        var y = lanes<int>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = Math.Max(x[i], y[i]);
+        return a;
+    }
+
+    public static Vector128<byte> I32x4MinU(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse41.IsSupported) return Sse41.Min(a.AsUInt32(), b.AsUInt32()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Min(a.AsUInt32(), b.AsUInt32()).AsByte();
+        var x = lanes<uint>(ref a);
+        var y = lanes<uint>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = Math.Min(x[i], y[i]);
+        return a;
+    }
+
+    public static Vector128<byte> I32x4MaxU(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse41.IsSupported) return Sse41.Max(a.AsUInt32(), b.AsUInt32()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Max(a.AsUInt32(), b.AsUInt32()).AsByte();
+        var x = lanes<uint>(ref a);
+        var y = lanes<uint>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = Math.Max(x[i], y[i]);
+        return a;
+    }
+
+    // pmaddwd is exactly dot: it multiplies the 16 bit lanes and adds neighbouring products.
+    public static Vector128<byte> I32x4DotI16x8S(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.MultiplyAddAdjacent(a.AsInt16(), b.AsInt16()).AsByte();
+        if (AdvSimd.Arm64.IsSupported)
+            return AdvSimd.Arm64.AddPairwise(I32x4ExtmulLowI16x8S(a, b).AsInt32(),
+                I32x4ExtmulHighI16x8S(a, b).AsInt32()).AsByte();
+        var x = lanes<short>(ref a);
+        var y = lanes<short>(ref b);
+        var r = new Vector128<byte>();
+        var l = lanes<int>(ref r);
+        for (int i = 0; i < l.Length; i++)
+            l[i] = x[2 * i] * y[2 * i] + x[2 * i + 1] * y[2 * i + 1];
+        return r;
+    }
+
+    public static Vector128<byte> I32x4ExtmulLowI16x8S(Vector128<byte> a, Vector128<byte> b) =>
+        I32x4Mul(I32x4ExtendLowI16x8S(a), I32x4ExtendLowI16x8S(b));
+
+    public static Vector128<byte> I32x4ExtmulHighI16x8S(Vector128<byte> a, Vector128<byte> b) =>
+        I32x4Mul(I32x4ExtendHighI16x8S(a), I32x4ExtendHighI16x8S(b));
+
+    public static Vector128<byte> I32x4ExtmulLowI16x8U(Vector128<byte> a, Vector128<byte> b) =>
+        I32x4Mul(I32x4ExtendLowI16x8U(a), I32x4ExtendLowI16x8U(b));
+
+    public static Vector128<byte> I32x4ExtmulHighI16x8U(Vector128<byte> a, Vector128<byte> b) =>
+        I32x4Mul(I32x4ExtendHighI16x8U(a), I32x4ExtendHighI16x8U(b));
+
+    // SSE has no 64 bit abs or arithmetic shift; both go through the sign of each lane, copied from its high half.
+    static Vector128<long> signOf(Vector128<byte> a) =>
+        Sse2.Shuffle(Sse2.ShiftRightArithmetic(a.AsInt32(), 31), 0b11_11_01_01).AsInt64();
+
+    public static Vector128<byte> I64x2Abs(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported)
+        {
+            var sign = signOf(a);
+            return Sse2.Subtract(Sse2.Xor(a.AsInt64(), sign), sign).AsByte();
+        }
+
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.Abs(a.AsInt64()).AsByte();
+        foreach (ref var x in lanes<long>(ref a))
+            x = x < 0 ? -x : x;
+        return a;
+    }
+
+    public static Vector128<byte> I64x2Neg(Vector128<byte> a) => I64x2Sub(Vector128<byte>.Zero, a);
+
+    public static Vector128<byte> I64x2ExtendLowI32x4S(Vector128<byte> a)
+    {
+        if (Sse41.IsSupported) return Sse41.ConvertToVector128Int64(a.AsInt32()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.SignExtendWideningLower(a.AsInt32().GetLower()).AsByte();
+        var x = lanes<int>(ref a);
+        return Vector128.Create((long) x[0], x[1]).AsByte();
+    }
+
+    public static Vector128<byte> I64x2ExtendHighI32x4S(Vector128<byte> a) => I64x2ExtendLowI32x4S(upperHalf(a));
+
+    public static Vector128<byte> I64x2ExtendLowI32x4U(Vector128<byte> a)
+    {
+        if (Sse41.IsSupported) return Sse41.ConvertToVector128Int64(a.AsUInt32()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.ZeroExtendWideningLower(a.AsUInt32().GetLower()).AsByte();
+        var x = lanes<uint>(ref a);
+        return Vector128.Create((ulong) x[0], x[1]).AsByte();
+    }
+
+    public static Vector128<byte> I64x2ExtendHighI32x4U(Vector128<byte> a) => I64x2ExtendLowI32x4U(upperHalf(a));
+
+    public static Vector128<byte> I64x2Shl(Vector128<byte> a, int n)
+    {
+        if (Sse2.IsSupported) return Sse2.ShiftLeftLogical(a.AsInt64(), (byte) (n & 63)).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.ShiftLogical(a.AsInt64(), Vector128.Create((long) (n & 63))).AsByte();
+        foreach (ref var x in lanes<long>(ref a))
+            x <<= n;
+        return a;
+    }
+
+    // shifting the sign bit along with the value and subtracting it sign-extends a logical shift.
+    public static Vector128<byte> I64x2ShrS(Vector128<byte> a, int n)
+    {
+        if (Sse2.IsSupported)
+        {
+            var sign = Vector128.Create((long) (1UL << 63 >> (n & 63)));
+            var shifted = Sse2.ShiftRightLogical(a.AsInt64(), (byte) (n & 63));
+            return Sse2.Subtract(Sse2.Xor(shifted, sign), sign).AsByte();
+        }
+
+        if (AdvSimd.IsSupported)
+            return AdvSimd.ShiftArithmetic(a.AsInt64(), Vector128.Create((long) -(n & 63))).AsByte();
+        foreach (ref var x in lanes<long>(ref a))
+            x >>= n;
+        return a;
+    }
+
+    public static Vector128<byte> I64x2ShrU(Vector128<byte> a, int n)
+    {
+        if (Sse2.IsSupported) return Sse2.ShiftRightLogical(a.AsInt64(), (byte) (n & 63)).AsByte();
+        if (AdvSimd.IsSupported)
+            return AdvSimd.ShiftLogical(a.AsUInt64(), Vector128.Create((long) -(n & 63))).AsByte();
+        foreach (ref var x in lanes<ulong>(ref a))
+            x >>= n;
+        return a;
+    }
+
+    public static Vector128<byte> I64x2Add(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Add(a.AsInt64(), b.AsInt64()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Add(a.AsInt64(), b.AsInt64()).AsByte();
+        var x = lanes<long>(ref a);
+        var y = lanes<long>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] += y[i];
+        return a;
+    }
+
+    public static Vector128<byte> I64x2Sub(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Subtract(a.AsInt64(), b.AsInt64()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Subtract(a.AsInt64(), b.AsInt64()).AsByte();
+        var x = lanes<long>(ref a);
+        var y = lanes<long>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] -= y[i];
+        return a;
+    }
+
+    public static Vector128<byte> I64x2Mul(Vector128<byte> a, Vector128<byte> b)
+    {
+        // SSE2 only multiplies 32 bit halves: lo*lo + ((hi*lo + lo*hi) << 32), the rest falls off the top.
+        if (Sse2.IsSupported)
+        {
+            var x = a.AsUInt32();
+            var y = b.AsUInt32();
+            var xHi = Sse2.ShiftRightLogical(a.AsUInt64(), 32).AsUInt32();
+            var yHi = Sse2.ShiftRightLogical(b.AsUInt64(), 32).AsUInt32();
+            var cross = Sse2.Add(Sse2.Multiply(xHi, y), Sse2.Multiply(x, yHi));
+            return Sse2.Add(Sse2.Multiply(x, y), Sse2.ShiftLeftLogical(cross, 32)).AsByte();
+        }
+
+        var l = lanes<long>(ref a);
+        var r = lanes<long>(ref b);
+        for (int i = 0; i < l.Length; i++)
+            l[i] *= r[i];
+        return a;
+    }
+
+    public static Vector128<byte> I64x2ExtmulLowI32x4S(Vector128<byte> a, Vector128<byte> b) =>
+        I64x2Mul(I64x2ExtendLowI32x4S(a), I64x2ExtendLowI32x4S(b));
+
+    public static Vector128<byte> I64x2ExtmulHighI32x4S(Vector128<byte> a, Vector128<byte> b) =>
+        I64x2Mul(I64x2ExtendHighI32x4S(a), I64x2ExtendHighI32x4S(b));
+
+    public static Vector128<byte> I64x2ExtmulLowI32x4U(Vector128<byte> a, Vector128<byte> b) =>
+        I64x2Mul(I64x2ExtendLowI32x4U(a), I64x2ExtendLowI32x4U(b));
+
+    public static Vector128<byte> I64x2ExtmulHighI32x4U(Vector128<byte> a, Vector128<byte> b) =>
+        I64x2Mul(I64x2ExtendHighI32x4U(a), I64x2ExtendHighI32x4U(b));
+
+    // roundps rounds to nearest with ties to even, like wasm's nearest and MathF.Round.
+    public static Vector128<byte> F32x4Ceil(Vector128<byte> a)
+    {
+        if (Sse41.IsSupported) return Sse41.RoundToPositiveInfinity(a.AsSingle()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.RoundToPositiveInfinity(a.AsSingle()).AsByte();
+        foreach (ref var x in lanes<float>(ref a))
+            x = MathF.Ceiling(x);
+        return a;
+    }
+
+    public static Vector128<byte> F32x4Floor(Vector128<byte> a)
+    {
+        if (Sse41.IsSupported) return Sse41.RoundToNegativeInfinity(a.AsSingle()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.RoundToNegativeInfinity(a.AsSingle()).AsByte();
+        foreach (ref var x in lanes<float>(ref a))
+            x = MathF.Floor(x);
+        return a;
+    }
+
+    public static Vector128<byte> F32x4Trunc(Vector128<byte> a)
+    {
+        if (Sse41.IsSupported) return Sse41.RoundToZero(a.AsSingle()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.RoundToZero(a.AsSingle()).AsByte();
+        foreach (ref var x in lanes<float>(ref a))
+            x = MathF.Truncate(x);
+        return a;
+    }
+
+    public static Vector128<byte> F32x4Nearest(Vector128<byte> a)
+    {
+        if (Sse41.IsSupported) return Sse41.RoundToNearestInteger(a.AsSingle()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.RoundToNearest(a.AsSingle()).AsByte();
+        foreach (ref var x in lanes<float>(ref a))
+            x = MathF.Round(x);
+        return a;
+    }
+
+    public static Vector128<byte> F32x4Abs(Vector128<byte> a) =>
+        V128And(a, Vector128.Create(0x7FFFFFFF).AsByte());
+
+    public static Vector128<byte> F32x4Neg(Vector128<byte> a) =>
+        V128Xor(a, Vector128.Create(int.MinValue).AsByte());
+
+    public static Vector128<byte> F32x4Sqrt(Vector128<byte> a)
+    {
+        if (Sse.IsSupported) return Sse.Sqrt(a.AsSingle()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.Sqrt(a.AsSingle()).AsByte();
+        foreach (ref var x in lanes<float>(ref a))
+            x = MathF.Sqrt(x);
+        return a;
+    }
+
+    public static Vector128<byte> F32x4Add(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse.IsSupported) return Sse.Add(a.AsSingle(), b.AsSingle()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Add(a.AsSingle(), b.AsSingle()).AsByte();
+        var x = lanes<float>(ref a);
+        var y = lanes<float>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] += y[i];
+        return a;
+    }
+
+    public static Vector128<byte> F32x4Sub(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse.IsSupported) return Sse.Subtract(a.AsSingle(), b.AsSingle()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Subtract(a.AsSingle(), b.AsSingle()).AsByte();
+        var x = lanes<float>(ref a);
+        var y = lanes<float>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] -= y[i];
+        return a;
+    }
+
+    public static Vector128<byte> F32x4Mul(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse.IsSupported) return Sse.Multiply(a.AsSingle(), b.AsSingle()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.Multiply(a.AsSingle(), b.AsSingle()).AsByte();
+        var x = lanes<float>(ref a);
+        var y = lanes<float>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] *= y[i];
+        return a;
+    }
+
+    public static Vector128<byte> F32x4Div(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse.IsSupported) return Sse.Divide(a.AsSingle(), b.AsSingle()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.Divide(a.AsSingle(), b.AsSingle()).AsByte();
+        var x = lanes<float>(ref a);
+        var y = lanes<float>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] /= y[i];
+        return a;
+    }
+
+    // minps/maxps return the second operand for NaN and for -0 against +0, wasm wants NaN and the lower zero.
+    // Lanes that are neither less nor greater are equal or unordered: or-ing equal ones yields -0 for min and
+    // and-ing them +0 for max, adding unordered ones passes the NaN operand on.
+    public static Vector128<byte> F32x4Min(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse.IsSupported || AdvSimd.IsSupported)
+            return select(F32x4Lt(a, b), a,
+                select(F32x4Gt(a, b), b, select(F32x4Eq(a, b), V128Or(a, b), F32x4Add(a, b))));
+        var x = lanes<float>(ref a);
+        var y = lanes<float>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = MathF.Min(x[i], y[i]);
+        return a;
+    }
+
+    public static Vector128<byte> F32x4Max(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse.IsSupported || AdvSimd.IsSupported)
+            return select(F32x4Gt(a, b), a,
+                select(F32x4Lt(a, b), b, select(F32x4Eq(a, b), V128And(a, b), F32x4Add(a, b))));
+        var x = lanes<float>(ref a);
+        var y = lanes<float>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = MathF.Max(x[i], y[i]);
+        return a;
+    }
+
+    // pmin and pmax are defined as b < a ? b : a and a < b ? b : a, which is what minps and maxps do with the
+    // operands swapped, NaN and signed zero included.
+    public static Vector128<byte> F32x4Pmin(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse.IsSupported) return Sse.Min(b.AsSingle(), a.AsSingle()).AsByte();
+        return select(F32x4Lt(b, a), b, a);
+    }
+
+    public static Vector128<byte> F32x4Pmax(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse.IsSupported) return Sse.Max(b.AsSingle(), a.AsSingle()).AsByte();
+        return select(F32x4Lt(a, b), b, a);
+    }
+
+    public static Vector128<byte> F64x2Ceil(Vector128<byte> a)
+    {
+        if (Sse41.IsSupported) return Sse41.RoundToPositiveInfinity(a.AsDouble()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.RoundToPositiveInfinity(a.AsDouble()).AsByte();
+        foreach (ref var x in lanes<double>(ref a))
+            x = Math.Ceiling(x);
+        return a;
+    }
+
+    public static Vector128<byte> F64x2Floor(Vector128<byte> a)
+    {
+        if (Sse41.IsSupported) return Sse41.RoundToNegativeInfinity(a.AsDouble()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.RoundToNegativeInfinity(a.AsDouble()).AsByte();
+        foreach (ref var x in lanes<double>(ref a))
+            x = Math.Floor(x);
+        return a;
+    }
+
+    public static Vector128<byte> F64x2Trunc(Vector128<byte> a)
+    {
+        if (Sse41.IsSupported) return Sse41.RoundToZero(a.AsDouble()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.RoundToZero(a.AsDouble()).AsByte();
+        foreach (ref var x in lanes<double>(ref a))
+            x = Math.Truncate(x);
+        return a;
+    }
+
+    public static Vector128<byte> F64x2Nearest(Vector128<byte> a)
+    {
+        if (Sse41.IsSupported) return Sse41.RoundToNearestInteger(a.AsDouble()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.RoundToNearest(a.AsDouble()).AsByte();
+        foreach (ref var x in lanes<double>(ref a))
+            x = Math.Round(x);
+        return a;
+    }
+
+    public static Vector128<byte> F64x2Abs(Vector128<byte> a) =>
+        V128And(a, Vector128.Create(long.MaxValue).AsByte());
+
+    public static Vector128<byte> F64x2Neg(Vector128<byte> a) =>
+        V128Xor(a, Vector128.Create(long.MinValue).AsByte());
+
+    public static Vector128<byte> F64x2Sqrt(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported) return Sse2.Sqrt(a.AsDouble()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.Sqrt(a.AsDouble()).AsByte();
+        foreach (ref var x in lanes<double>(ref a))
+            x = Math.Sqrt(x);
+        return a;
+    }
+
+    public static Vector128<byte> F64x2Add(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Add(a.AsDouble(), b.AsDouble()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.Add(a.AsDouble(), b.AsDouble()).AsByte();
+        var x = lanes<double>(ref a);
+        var y = lanes<double>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] += y[i];
+        return a;
+    }
+
+    public static Vector128<byte> F64x2Sub(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Subtract(a.AsDouble(), b.AsDouble()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.Subtract(a.AsDouble(), b.AsDouble()).AsByte();
+        var x = lanes<double>(ref a);
+        var y = lanes<double>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] -= y[i];
+        return a;
+    }
+
+    public static Vector128<byte> F64x2Mul(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Multiply(a.AsDouble(), b.AsDouble()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.Multiply(a.AsDouble(), b.AsDouble()).AsByte();
+        var x = lanes<double>(ref a);
+        var y = lanes<double>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] *= y[i];
+        return a;
+    }
+
+    public static Vector128<byte> F64x2Div(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Divide(a.AsDouble(), b.AsDouble()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.Divide(a.AsDouble(), b.AsDouble()).AsByte();
+        var x = lanes<double>(ref a);
+        var y = lanes<double>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] /= y[i];
+        return a;
+    }
+
+    public static Vector128<byte> F64x2Min(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported || AdvSimd.Arm64.IsSupported)
+            return select(F64x2Lt(a, b), a,
+                select(F64x2Gt(a, b), b, select(F64x2Eq(a, b), V128Or(a, b), F64x2Add(a, b))));
+        var x = lanes<double>(ref a);
+        var y = lanes<double>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = Math.Min(x[i], y[i]);
+        return a;
+    }
+
+    public static Vector128<byte> F64x2Max(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported || AdvSimd.Arm64.IsSupported)
+            return select(F64x2Gt(a, b), a,
+                select(F64x2Lt(a, b), b, select(F64x2Eq(a, b), V128And(a, b), F64x2Add(a, b))));
+        var x = lanes<double>(ref a);
+        var y = lanes<double>(ref b);
+        for (int i = 0; i < x.Length; i++)
+            x[i] = Math.Max(x[i], y[i]);
+        return a;
+    }
+
+    public static Vector128<byte> F64x2Pmin(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Min(b.AsDouble(), a.AsDouble()).AsByte();
+        return select(F64x2Lt(b, a), b, a);
+    }
+
+    public static Vector128<byte> F64x2Pmax(Vector128<byte> a, Vector128<byte> b)
+    {
+        if (Sse2.IsSupported) return Sse2.Max(b.AsDouble(), a.AsDouble()).AsByte();
+        return select(F64x2Lt(a, b), b, a);
+    }
+
+    public static Vector128<byte> I32x4TruncSatF32x4S(Vector128<byte> a)
+    {
+        if (AdvSimd.IsSupported) return AdvSimd.ConvertToInt32RoundToZero(a.AsSingle()).AsByte();
+        var x = lanes<float>(ref a);
+        var r = lanes<int>(ref a);
+        for (int i = 0; i < x.Length; i++)
+            r[i] = Conversions.I32TruncSatF32S(x[i]);
+        return a;
+    }
+
+    public static Vector128<byte> F32x4ConvertI32x4S(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported) return Sse2.ConvertToVector128Single(a.AsInt32()).AsByte();
+        if (AdvSimd.IsSupported) return AdvSimd.ConvertToSingle(a.AsInt32()).AsByte();
+        var x = lanes<int>(ref a);
+        var r = lanes<float>(ref a);
+        for (int i = 0; i < x.Length; i++)
+            r[i] = x[i];
+        return a;
+    }
+
+    // fcvtzu saturates and turns NaN into zero, like trunc_sat.
+    public static Vector128<byte> I32x4TruncSatF32x4U(Vector128<byte> a)
+    {
+        if (AdvSimd.IsSupported) return AdvSimd.ConvertToUInt32RoundToZero(a.AsSingle()).AsByte();
+        var x = lanes<float>(ref a);
+        var r = lanes<int>(ref a);
+        for (int i = 0; i < x.Length; i++)
+            r[i] = Conversions.I32TruncSatF32U(x[i]);
+        return a;
+    }
+
+    // the two 16 bit halves convert exactly, so only the final add rounds.
+    public static Vector128<byte> F32x4ConvertI32x4U(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported)
+        {
+            var hi = Sse2.ConvertToVector128Single(Sse2.ShiftRightLogical(a.AsInt32(), 16));
+            var lo = Sse2.ConvertToVector128Single(Sse2.And(a.AsInt32(), Vector128.Create(0xFFFF)));
+            return Sse.Add(Sse.Multiply(hi, Vector128.Create(65536f)), lo).AsByte();
+        }
+
+        if (AdvSimd.IsSupported) return AdvSimd.ConvertToSingle(a.AsUInt32()).AsByte();
+        var x = lanes<uint>(ref a);
+        var r = lanes<float>(ref a);
+        for (int i = 0; i < x.Length; i++)
+            r[i] = x[i];
+        return a;
+    }
+
+    public static Vector128<byte> I32x4TruncSatF64x2SZero(Vector128<byte> a)
+    {
+        var x = lanes<double>(ref a);
+        return Vector128.Create(Conversions.I32TruncSatF64S(x[0]), Conversions.I32TruncSatF64S(x[1]), 0, 0)
+            .AsByte();
+    }
+
+    public static Vector128<byte> I32x4TruncSatF64x2UZero(Vector128<byte> a)
+    {
+        var x = lanes<double>(ref a);
+        return Vector128.Create(Conversions.I32TruncSatF64U(x[0]), Conversions.I32TruncSatF64U(x[1]), 0, 0)
+            .AsByte();
+    }
+
+    public static Vector128<byte> F64x2ConvertLowI32x4S(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported) return Sse2.ConvertToVector128Double(a.AsInt32()).AsByte();
+        var x = lanes<int>(ref a);
+        return Vector128.Create((double) x[0], x[1]).AsByte();
+    }
+
+    // 2^52 with the value as its low mantissa bits is exactly 2^52 + value.
+    public static Vector128<byte> F64x2ConvertLowI32x4U(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported)
+        {
+            var biased = Sse2.UnpackLow(a.AsUInt32(), Vector128.Create(0x43300000u)).AsDouble();
+            return Sse2.Subtract(biased, Vector128.Create(4503599627370496.0)).AsByte();
+        }
+
+        var x = lanes<uint>(ref a);
+        return Vector128.Create((double) x[0], x[1]).AsByte();
+    }
+
+    public static Vector128<byte> F32x4DemoteF64x2Zero(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported) return Sse2.ConvertToVector128Single(a.AsDouble()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.ConvertToSingleLower(a.AsDouble()).ToVector128().AsByte();
+        var x = lanes<double>(ref a);
+        return Vector128.Create((float) x[0], (float) x[1], 0, 0).AsByte();
+    }
+
+    public static Vector128<byte> F64x2PromoteLowF32x4(Vector128<byte> a)
+    {
+        if (Sse2.IsSupported) return Sse2.ConvertToVector128Double(a.AsSingle()).AsByte();
+        if (AdvSimd.Arm64.IsSupported) return AdvSimd.Arm64.ConvertToDouble(a.AsSingle().GetLower()).AsByte();
+        var x = lanes<float>(ref a);
+        return Vector128.Create((double) x[0], x[1]).AsByte();
+    }
+}
@@ -0,0 +1,151 @@
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace Wasm2Il;
+
+/// <summary>
+/// A wasm trap. Compiled code and the runtime helpers it calls throw the subclasses directly where they check for
+/// the trap themselves, loads and stores through Traps.Access; unsigned division relies on the CLR's own check,
+/// whose exception Traps.Translate maps to the same type.
+/// </summary>
+public class WasmTrap : Exception
+{
+    public WasmTrap(string message, Exception? inner = null) : base(message, inner)
+    {
+    }
+}
+
+public class UnreachableTrap : WasmTrap
+{
+    public UnreachableTrap() : base("unreachable")
+    {
+    }
+}
+
+public class OutOfBoundsTrap : WasmTrap
+{
+    public OutOfBoundsTrap(Exception? inner = null) : base("out of bounds memory access", inner)
+    {
+    }
+}
+
+public class DivideByZeroTrap : WasmTrap
+{
+    public DivideByZeroTrap(Exception? inner = null) : base("integer divide by zero", inner)
+    {
+    }
+}
+
+public class IntegerOverflowTrap : WasmTrap
+{
+    public IntegerOverflowTrap(Exception? inner = null) : base("integer overflow", inner)
+    {
+    }
+}
+
+public class InvalidConversionTrap : WasmTrap
+{
+    public InvalidConversionTrap() : base("invalid conversion to integer")
+    {
+    }
+}
+
+public class IndirectCallTrap : WasmTrap
+{
+    public IndirectCallTrap(string message) : base(message)
+    {
+    }
+}
+
+/// <summary>
+/// Marks the type the transformer generates for a module, so runtime exceptions raised in it can be told apart
+/// from the same exceptions thrown by host code.
+/// </summary>
+[AttributeUsage(AttributeTargets.Class)]
+public class WasmModuleAttribute : Attribute
+{
+}
+
+/// <summary>
+/// Creates traps for compiled code. The factories are never inlined, so a trap site costs a call and a throw
+/// in the caller and the methods around it stay small enough to be inlined themselves.
+/// </summary>
+public static class Traps
+{
+    [MethodImpl(MethodImplOptions.NoInlining)]
+    public static WasmTrap Unreachable() => new UnreachableTrap();
+
+    [MethodImpl(MethodImplOptions.NoInlining)]
+    public static WasmTrap DivideByZero() => new DivideByZeroTrap();
+
+    [MethodImpl(MethodImplOptions.NoInlining)]
+    public static WasmTrap IntegerOverflow() => new IntegerOverflowTrap();
+
+    [MethodImpl(MethodImplOptions.NoInlining)]
+    public static WasmTrap InvalidConversion() => new InvalidConversionTrap();
+
+    [MethodImpl(MethodImplOptions.NoInlining)]
+    public static WasmTrap OutOfBounds() => new OutOfBoundsTrap();
+
+    /// <summary>
+    /// Traps unless length bytes at address lie in memory, both taken as unsigned like wasm addresses.
+    /// </summary>
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static void CheckBounds(byte[] memory, int address, int length)
+    {
+        if ((ulong) (uint) address + (uint) length > (ulong) memory.Length)
+            throw OutOfBounds();
+    }
+
+    /// <summary>
+    /// The first of size bytes at address + offset, for a load or store of that size. Traps unless all of them lie
+    /// in memory, which an array index check on the first byte would not ensure.
+    /// </summary>
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static ref byte Access(byte[] memory, int address, uint offset, int size)
+    {
+        var effective = (ulong) (uint) address + offset;
+        if (effective + (uint) size > (ulong) memory.Length)
+            throw OutOfBounds();
+        return ref Unsafe.Add(ref MemoryMarshal.GetArrayDataReference(memory), (nint) effective);
+    }
+
+    [MethodImpl(MethodImplOptions.NoInlining)]
+    static WasmTrap indirectCall(object?[] table, int index) =>
+        new IndirectCallTrap((uint) index >= (uint) table.Length || table[index] == null
+            ? "undefined element"
+            : "indirect call type mismatch");
+
+    /// <summary>
+    /// The target of a call_indirect. Functions are stored as delegates of their signature, so a type check
+    /// against the delegate type is the signature check.
+    /// </summary>
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public static T CallTarget<T>(object?[] table, int index) where T : class
+    {
+        if ((uint) index < (uint) table.Length && table[index] is T target)
+            return target;
+        throw indirectCall(table, index);
+    }
+
+    /// <summary>
+    /// Maps an exception thrown by compiled code to the trap it represents, or returns null if it is not a trap,
+    /// e.g. a ProcExitException or an error in a host function. Array index and division exceptions only count
+    /// when the CLR raised them in a generated module.
+    /// </summary>
+    public static WasmTrap? Translate(Exception e)
+    {
+        if (e is System.Reflection.TargetInvocationException {InnerException: { } inner})
+            e = inner;
+        if (e is WasmTrap trap)
+            return trap;
+        if (e.TargetSite?.DeclaringType?.IsDefined(typeof(WasmModuleAttribute), false) != true)
+            return null;
+        return e switch
+        {
+            IndexOutOfRangeException => new OutOfBoundsTrap(e),
+            DivideByZeroException => new DivideByZeroTrap(e),
+            _ => null
+        };
+    }
+}
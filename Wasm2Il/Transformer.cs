@@ -1,6 +1,7 @@
 using System.Numerics;
 using System.Reflection;
 using System.Runtime.CompilerServices;
+using System.Runtime.Intrinsics;
 using Mono.Cecil;
 using Mono.Cecil.Cil;
 using Mono.Cecil.Rocks;
@@ -36,7 +37,7 @@ namespace Wasm2Il
         FieldDefinition memoryField;
         FieldDefinition functionTable;
 
-        TypeReference f32Type, f64Type, i64Type, i32Type, voidType, byteType;
+        TypeReference f32Type, f64Type, i64Type, i32Type, voidType, byteType, v128Type;
 
         MethodReference resolveTypeConstructor(Type t, params Type[] argTypes)
         {
@@ -58,11 +59,14 @@ namespace Wasm2Il
             i32Type = asm.MainModule.TypeSystem.Int32;
             voidType = asm.MainModule.TypeSystem.Void;
             byteType = asm.MainModule.TypeSystem.Byte;
+            v128Type = asm.MainModule.ImportReference(typeof(Vector128<byte>));
             cls = new TypeDefinition(asmName, "Code",
                 TypeAttributes.AnsiClass | TypeAttributes.BeforeFieldInit | TypeAttributes.Class |
                 TypeAttributes.Abstract | TypeAttributes.Sealed | TypeAttributes.Public,
                 asm.MainModule.TypeSystem.Object);
 
+            cls.CustomAttributes.Add(new CustomAttribute(
+                asm.MainModule.ImportReference(typeof(WasmModuleAttribute).GetConstructor(Type.EmptyTypes))));
             asm.MainModule.Types.Add(cls);
             def = asm;
 
@@ -151,13 +155,12 @@ namespace Wasm2Il
                 Assert.AreEqual(next, str.Position);
             }
 
-            var wasi = typeof(Wasi);
             foreach (var kv in ImportFuncs
                          .Where(x => x.Value.Method == null)
                          .ToArray())
             {
                 var imp = kv.Value;
-                if (wasi.GetMethod(imp.Name) != null) continue;
+                if (methodFromImport(imp) != null) continue;
                 var type = Types[(uint) imp.TypeId];
                 var m = new MethodDefinition(imp.Name, MethodAttributes.Public | MethodAttributes.Static,
                     type.ReturnType);
@@ -184,6 +187,7 @@ namespace Wasm2Il
 
             reader.Position = codeLoc;
             ReadCodeSection(reader);
+            Policy?.Apply(cls, Profile, functionName);
 
             def.Write(outpath);
             Console.WriteLine("Output written to " + outpath);
@@ -388,12 +392,20 @@ namespace Wasm2Il
             }
         }
 
+        // maps an imported reference, such as a tuple's type argument, back to the module's own instance.
+        TypeReference valueType(TypeReference r) =>
+            new[] {i32Type, i64Type, f32Type, f64Type, v128Type}.FirstOrDefault(x => x.FullName == r.FullName) ?? r;
+
         Type refToType(TypeReference r)
         {
+            r = valueType(r);
             if (r == i32Type) return typeof(int);
             if (r == i64Type) return typeof(long);
             if (r == f32Type) return typeof(float);
             if (r == f64Type) return typeof(double);
+            if (r == v128Type) return typeof(Vector128<byte>);
+            if (isTuple(r))
+                return tupleType(((GenericInstanceType) r).GenericArguments.Select(refToType).ToArray());
             return typeof(void);
         }
 
@@ -402,8 +414,18 @@ namespace Wasm2Il
             uint dataCount = reader.ReadU32Leb();
             for (int i = 0; i < dataCount; i++)
             {
-                uint memidx = reader.ReadU32Leb();
-                // memory index is normally 0.
+                // 0: active, 1: passive, 2: active with a memory index, which is always 0.
+                uint flags = reader.ReadU32Leb();
+                if (flags == 1)
+                {
+                    var bytes = new byte[reader.ReadU32Leb()];
+                    reader.Read(bytes);
+                    dataSegments[(uint) i] = passiveSegment(i, bytes);
+                    continue;
+                }
+
+                if (flags == 2)
+                    reader.ReadU32Leb();
                 bool isGlobal = false;
                 int offset = 0;
                 while (true)
@@ -458,33 +480,169 @@ namespace Wasm2Il
             }
         }
 
+        // passive data segments by index; active segments have no field.
+        Dictionary<uint, FieldDefinition> dataSegments = new();
+
+        /// <summary>
+        /// Creates a static byte[] holding a passive data segment. The bytes are stored in the assembly as field
+        /// data and copied into the array with InitializeArray, the way C# array initializers work.
+        /// </summary>
+        FieldDefinition passiveSegment(int index, byte[] bytes)
+        {
+            var field = new FieldDefinition("data" + index, FieldAttributes.Static | FieldAttributes.Private,
+                byteType.MakeArrayType());
+            cls.Fields.Add(field);
+
+            var cctor = cls.GetStaticConstructor();
+            var il = cctor.Body.GetILProcessor();
+            il.RemoveAt(cctor.Body.Instructions.Count - 1); // remove RET
+            il.Emit(IlInstr.Ldc_I4, bytes.Length);
+            il.Emit(IlInstr.Newarr, byteType);
+            if (bytes.Length > 0)
+            {
+                var blob = new TypeDefinition("", "DataBlob" + index,
+                    TypeAttributes.NestedPrivate | TypeAttributes.ExplicitLayout | TypeAttributes.Sealed,
+                    def.MainModule.ImportReference(typeof(ValueType)))
+                {
+                    PackingSize = 1, ClassSize = bytes.Length
+                };
+                cls.NestedTypes.Add(blob);
+                var rva = new FieldDefinition("data" + index + "_rva",
+                    FieldAttributes.Static | FieldAttributes.Private | FieldAttributes.InitOnly |
+                    FieldAttributes.HasFieldRVA, blob) {InitialValue = bytes};
+                cls.Fields.Add(rva);
+                il.Emit(IlInstr.Dup);
+                il.Emit(IlInstr.Ldtoken, rva);
+                il.Emit(IlInstr.Call, def.MainModule.ImportReference(
+                    typeof(RuntimeHelpers).GetMethod(nameof(RuntimeHelpers.InitializeArray))));
+            }
+
+            il.Emit(IlInstr.Stsfld, field);
+            il.Emit(IlInstr.Ret);
+            return field;
+        }
+
+        /// <summary>
+        /// Loads the bytes of a data segment; active and dropped segments are empty.
+        /// </summary>
+        void emitLoadSegment(ILProcessor il, uint index)
+        {
+            if (dataSegments.TryGetValue(index, out var field))
+                il.Emit(IlInstr.Ldsfld, field);
+            else
+                emitEmptyBytes(il);
+        }
+
+        void emitEmptyBytes(ILProcessor il) =>
+            il.Emit(IlInstr.Call, def.MainModule.ImportReference(
+                typeof(Array).GetMethod(nameof(Array.Empty))!.MakeGenericMethod(typeof(byte))));
+
         class LabelType
         {
-            public byte Type;
+            public TypeReference[] Params = Array.Empty<TypeReference>();
+            public TypeReference[] Results = Array.Empty<TypeReference>();
             public Instruction? EndLabel;
-            public bool Forward;
+            public bool IsLoop;
             public Instruction? StartLabel;
+            // for if blocks, where the else branch starts; placed at else, or at end if there is none.
+            public Instruction? ElseLabel;
+            // the type stack below the block's parameters when it was entered.
+            public TypeReference[] Entry = Array.Empty<TypeReference>();
+
+            /// <summary>
+            /// Values a branch to this label carries: the parameters for a loop, otherwise the results.
+            /// </summary>
+            public TypeReference[] BranchTypes => IsLoop ? Params : Results;
+
+            /// <summary>
+            /// Where a branch to this label goes: the start of a loop, otherwise the end of the block.
+            /// </summary>
+            public Instruction? BranchLabel => IsLoop ? StartLabel : EndLabel;
         }
 
-        private Dictionary<string, MethodReference?> methodCache = new Dictionary<string, MethodReference?>();
+        /// <summary>
+        /// Host functions imports and overrides are bound to.
+        /// </summary>
+        public HostRegistry Hosts = HostRegistry.Default;
 
-        MethodReference? methodFromName(string name)
+        private Dictionary<(string, string), MethodReference?> methodCache = new();
+
+        MethodReference? methodFromImport(ImportFunc importFun)
         {
-            if (name == null) return null;
-            if (methodCache.TryGetValue(name, out var m))
+            if (importFun.Name == null) return null;
+            var key = (importFun.Module ?? "", importFun.Name);
+            if (methodCache.TryGetValue(key, out var m))
             {
                 return m;
             }
 
-            var imp = typeof(Wasi);
-            var method = imp.GetMethod(name);
-            if (method != null)
+            var host = Hosts.FindImport(key.Item1, key.Item2);
+            if (host == null)
+                return methodCache[key] = null;
+            if (host.InstanceType == null)
+                return methodCache[key] = def.MainModule.ImportReference(host.Method);
+
+            // instance methods get a static stub, so call sites can push the arguments as usual.
+            var type = Types[(uint) importFun.TypeId!];
+            var stub = new MethodDefinition(importFun.Name.Replace(":", "_"),
+                MethodAttributes.Static | MethodAttributes.Public, type.ReturnType);
+            foreach (var param in type.ParamTypes)
+                stub.Parameters.Add(new ParameterDefinition(param));
+            var il = stub.Body.GetILProcessor();
+            emitHostCall(il, host, stub.Parameters, null);
+            cls.Methods.Add(stub);
+            return methodCache[key] = stub;
+        }
+
+        static bool takesContext(MethodReference method) =>
+            method.Parameters.Count > 0 &&
+            method.Parameters[^1].ParameterType.FullName == typeof(Wasi.Context).FullName!.Replace('+', '/');
+
+        Dictionary<Type, FieldDefinition> hostInstances = new();
+
+        /// <summary>
+        /// A static field holding the instance used for a host type, fetched once in the static constructor.
+        /// </summary>
+        FieldDefinition hostInstanceField(Type type)
+        {
+            if (hostInstances.TryGetValue(type, out var field))
+                return field;
+            field = new FieldDefinition("host_" + type.Name,
+                FieldAttributes.Static | FieldAttributes.Private | FieldAttributes.InitOnly,
+                def.MainModule.ImportReference(type));
+            cls.Fields.Add(field);
+            var cctor = cls.GetStaticConstructor();
+            var il = cctor.Body.GetILProcessor();
+            var first = cctor.Body.Instructions[0];
+            il.InsertBefore(first, il.Create(IlInstr.Ldtoken, def.MainModule.ImportReference(type)));
+            il.InsertBefore(first, il.Create(IlInstr.Call,
+                def.MainModule.ImportReference(typeof(HostRegistry).GetMethod(nameof(HostRegistry.GetInstance)))));
+            il.InsertBefore(first, il.Create(IlInstr.Castclass, def.MainModule.ImportReference(type)));
+            il.InsertBefore(first, il.Create(IlInstr.Stsfld, field));
+            return hostInstances[type] = field;
+        }
+
+        /// <summary>
+        /// Emits a tail that forwards the method's arguments to a host function and returns its result.
+        /// </summary>
+        void emitHostCall(ILProcessor il, HostFunction host, IList<ParameterDefinition> args, FieldDefinition? original)
+        {
+            if (host.InstanceType != null)
+                il.Emit(IlInstr.Ldsfld, hostInstanceField(host.InstanceType));
+            foreach (var p in args)
+                il.Emit(IlInstr.Ldarg, p);
+            if (original != null)
+                il.Emit(IlInstr.Ldsfld, original);
+            if (host.TakesContext)
             {
-                m = def.MainModule.ImportReference(method);
-                return methodCache[name] = m;
+                il.Emit(IlInstr.Ldtoken, cls);
+                il.Emit(IlInstr.Call,
+                    def.MainModule.ImportReference(typeof(Wasi).GetMethod(nameof(Wasi.GetContext))));
             }
 
-            return methodCache[name] = null;
+            il.Emit(host.InstanceType != null ? IlInstr.Callvirt : IlInstr.Call,
+                def.MainModule.ImportReference(host.Method));
+            il.Emit(IlInstr.Ret);
         }
 
         MethodReference? resolveMethod(uint func)
@@ -495,7 +653,7 @@ namespace Wasm2Il
                 if (importFun.Method == null)
                 {
                     var type = Types[(uint) importFun.TypeId];
-                    var method = methodFromName(importFun.Name);
+                    var method = methodFromImport(importFun);
                     if (method != null)
                     {
                         importFun.Method = method;
@@ -526,6 +684,132 @@ namespace Wasm2Il
             return declFun;
         }
 
+        /// <summary>
+        /// Creates a static field holding a delegate of the given type to an overridden function,
+        /// initialized once in the static constructor.
+        /// </summary>
+        FieldDefinition bindOriginal(MethodDefinition original, Type delegateType)
+        {
+            var invoke = delegateType.GetMethod("Invoke")!;
+            if (invoke.GetParameters().Length != original.Parameters.Count)
+                throw new Exception("Unmatched delegate for " + original.Name);
+            var field = new FieldDefinition(original.Name + "_delegate",
+                FieldAttributes.Static | FieldAttributes.Private | FieldAttributes.InitOnly,
+                def.MainModule.ImportReference(delegateType));
+            cls.Fields.Add(field);
+
+            var cctor = cls.GetStaticConstructor();
+            var il = cctor.Body.GetILProcessor();
+            var first = cctor.Body.Instructions[0];
+            il.InsertBefore(first, il.Create(IlInstr.Ldnull));
+            il.InsertBefore(first, il.Create(IlInstr.Ldftn, original));
+            il.InsertBefore(first, il.Create(IlInstr.Newobj,
+                def.MainModule.ImportReference(delegateType.GetConstructor(new[] {typeof(object), typeof(IntPtr)}))));
+            il.InsertBefore(first, il.Create(IlInstr.Stsfld, field));
+            return field;
+        }
+
+        /// <summary>
+        /// Replace the bodies of memcpy, memmove, memset, memcmp and strlen with calls to LibcIntrinsics.
+        /// </summary>
+        public bool Intrinsics;
+
+        bool emitIntrinsic(MethodDefinition method, TypeId type)
+        {
+            if (!LibcIntrinsics.Signatures.TryGetValue(method.Name, out var paramCount))
+                return false;
+            if (type.ParamCount != paramCount || type.ParamTypes.Any(x => x != i32Type) || type.ReturnType != i32Type)
+                return false;
+            var il = method.Body.GetILProcessor();
+            il.Emit(IlInstr.Ldsfld, memoryField);
+            foreach (var p in method.Parameters)
+                il.Emit(IlInstr.Ldarg, p);
+            il.Emit(IlInstr.Call, def.MainModule.ImportReference(typeof(LibcIntrinsics).GetMethod(method.Name)));
+            il.Emit(IlInstr.Ret);
+            Console.WriteLine("Intrinsic: {0}", method.Name);
+            return true;
+        }
+
+        /// <summary>
+        /// Count how often each function is entered and its loops iterate, for Profile.Collect.
+        /// </summary>
+        public bool CountCalls;
+
+        /// <summary>
+        /// If set, the functions the profile marks hot get the optimizing tier on top of the passes every function
+        /// gets: leaf inlining up to HotInlineBudget and constant propagation through locals.
+        /// </summary>
+        public Profile? Profile;
+
+        /// <summary>
+        /// The largest function, in IL instructions, that is inlined into its callers if it calls no other function.
+        /// 0 disables inlining.
+        /// </summary>
+        public int InlineBudget = 40;
+
+        /// <summary>
+        /// The inline budget of the functions the profile marks hot.
+        /// </summary>
+        public int HotInlineBudget = 120;
+
+        // the module function each translated body belongs to. A host override renames the body to X_pre and
+        // gives the function's own name to its wrapper, while counters, the profile and overrides use X.
+        readonly Dictionary<MethodDefinition, string> functionNames = new();
+
+        string? functionName(MethodDefinition method) => functionNames.GetValueOrDefault(method);
+
+        bool isHot(MethodDefinition method) => functionName(method) is { } name && Profile?.IsHot(name) == true;
+
+        /// <summary>
+        /// Runs the optimization passes over a function body; hot ones also get their locals' constants propagated,
+        /// which mostly pays off once inlining has turned constant arguments into locals.
+        /// </summary>
+        void optimize(Mono.Cecil.Cil.MethodBody body, bool hot)
+        {
+            optimizeBranches(body);
+            Peephole.Optimize(body);
+            if (hot && Locals.PropagateConstants(body))
+                Peephole.Optimize(body);
+            if (Locals.Optimize(body))
+                Peephole.Optimize(body);
+        }
+
+        /// <summary>
+        /// The MethodImpl flags given to generated methods, or null to leave them to the JIT.
+        /// </summary>
+        public MethodPolicy? Policy = new();
+
+        /// <summary>
+        /// Inlines small leaf functions into their callers, larger ones into hot callers, then optimizes the callers
+        /// again.
+        /// </summary>
+        void inlineLeaves()
+        {
+            var leaves = leavesWithin(InlineBudget);
+            var hotLeaves = Profile == null ? leaves : leavesWithin(HotInlineBudget);
+            foreach (var caller in cls.Methods)
+            {
+                if (caller.IsConstructor || !caller.HasBody)
+                    continue;
+                var hot = isHot(caller);
+                if (Inliner.InlineCalls(caller.Body, (hot ? hotLeaves : leaves).Contains))
+                    optimize(caller.Body, hot);
+            }
+        }
+
+        HashSet<MethodDefinition> leavesWithin(int budget) =>
+            new(cls.Methods.Where(m => budget > 0 && Inliner.IsLeaf(m, budget)));
+
+        void emitCount(ILProcessor il, FieldDefinition counter)
+        {
+            il.Emit(IlInstr.Ldsflda, counter);
+            il.Emit(IlInstr.Dup);
+            il.Emit(IlInstr.Ldind_I8);
+            il.Emit(IlInstr.Ldc_I8, 1L);
+            il.Emit(IlInstr.Add);
+            il.Emit(IlInstr.Stind_I8);
+        }
+
         void ReadCodeSection(BinReader reader)
         {
             uint funcCount = reader.ReadU32Leb();
@@ -556,58 +840,52 @@ namespace Wasm2Il
                 }
             }
 
-            var wasi = typeof(Wasi);
-
             for (uint i = 0; i < funcCount; i++)
             {
                 var funcId = FuncDecl[i];
                 var ftype = Types[funcId.TypeId];
                 var m1 = funcId.Method;
 
-                var wasiMethod = wasi.GetMethod(m1.Name);
-                if (wasiMethod != null)
+                var host = Hosts.FindOverride(m1.Name);
+                if (host != null)
                 {
-                    var m2 = new MethodDefinition(wasiMethod.Name + "_pre",
+                    var wasiMethod = host.Method;
+                    var m2 = new MethodDefinition(m1.Name + "_pre",
                         MethodAttributes.Static | MethodAttributes.Public,
                         ftype.ReturnType);
+                    for (uint i2 = 0; i2 < ftype.ParamCount; i2++)
+                    {
+                        var parameter = new ParameterDefinition(ftype.ParamTypes[i2]);
+                        parameter.Name = "param" + i2;
+                        m2.Parameters.Add(parameter);
+                    }
+
                     cls.Methods.Add(m1);
                     var il2 = m1.Body.GetILProcessor();
                     m1.Body.InitLocals = true;
-                    var wasiMethod2 = def.MainModule.ImportReference(wasiMethod);
-                    if (wasiMethod2.Parameters.Count != m1.Parameters.Count + 1)
+                    // an override may take a delegate to the original function after the arguments.
+                    var wasiParams = wasiMethod.GetParameters();
+                    var originalType = wasiParams.Length > m1.Parameters.Count
+                        ? wasiParams[m1.Parameters.Count].ParameterType
+                        : null;
+                    if (originalType != null && !typeof(Delegate).IsAssignableFrom(originalType))
+                        originalType = null;
+                    if (wasiParams.Length !=
+                        m1.Parameters.Count + (originalType == null ? 0 : 1) + (host.TakesContext ? 1 : 0))
                     {
                         throw new Exception("Unmatched paramters");
                     }
-                    if(wasiMethod2.ReturnType.FullName != m1.ReturnType.FullName)
+                    if(def.MainModule.ImportReference(wasiMethod.ReturnType).FullName != m1.ReturnType.FullName)
                         throw new Exception("Unmatched return type.");
-                    for(int i2 = 0; i2 < m1.Parameters.Count; i2++)
-                    {
-                        var p = m1.Parameters[i2];
-                        il2.Emit(IlInstr.Ldarg, p);
-                        if (false && wasiMethod2.Parameters[i2].ParameterType.FullName != p.ParameterType.FullName)
-                            throw new Exception("Unmatched parameters types");
-                    }
 
-                    il2.Emit(IlInstr.Ldtoken, cls);
-                    il2.Emit(IlInstr.Call,
-                        def.MainModule.ImportReference(
-                            wasi.GetMethod(nameof(Wasi.GetContext))));
-                    il2.Emit(IlInstr.Call, wasiMethod2);
-                    il2.Emit(IlInstr.Ret);
-                    
-                   
-                    for (uint i2 = 0; i2 < ftype.ParamCount; i2++)
-                    {
-                        var parameter = new ParameterDefinition(ftype.ParamTypes[i2]);
-                        parameter.Name = "param" + i2;
-                        m2.Parameters.Add(parameter);
-                    }
-                    
+                    emitHostCall(il2, host, m1.Parameters,
+                        originalType == null ? null : bindOriginal(m2, originalType));
 
                     m1 = m2;
                     Console.WriteLine("Override: {0}", wasiMethod);
                 }
                 cls.Methods.Add(m1);
+                functionNames[m1] = funcId.Method.Name;
                 m1.Body.InitLocals = true;
                 var il = m1.Body.GetILProcessor();
                 il.Emit(IlInstr.Nop);
@@ -615,6 +893,20 @@ namespace Wasm2Il
                 var codeSize = reader.ReadU32Leb();
 
                 var next = reader.Position + codeSize;
+                if (Intrinsics && emitIntrinsic(m1, ftype))
+                {
+                    reader.Position = next;
+                    continue;
+                }
+
+                FieldDefinition? counter = null;
+                if (CountCalls)
+                {
+                    counter = new FieldDefinition(Profile.CounterPrefix + funcId.Method.Name,
+                        FieldAttributes.Static | FieldAttributes.Private, i64Type);
+                    cls.Fields.Add(counter);
+                    emitCount(il, counter);
+                }
 
                 var localCount = reader.ReadU32Leb();
                 uint localTotal = 0;
@@ -650,10 +942,9 @@ namespace Wasm2Il
                 var heapaddr = new VariableDefinition(def.MainModule.TypeSystem.Int32);
                 m1.Body.Variables.Add(heapaddr);
 
-                m1.Body.InitLocals = true;
                 int codeidx = 0;
                 var labelStack = new List<LabelType>();
-                labelStack.Add(new LabelType()); // base label
+                labelStack.Add(new LabelType {Results = ftype.ReturnTypes}); // base label, a branch to it returns
                 List<instr> instructions = new List<instr>();
 
                 // to satisfy SELECT.
@@ -669,30 +960,88 @@ namespace Wasm2Il
                 TypeReference pop(int i = 1)
                 {
                     if (i == 0) return default;
-                    while (i > 1)
+                    TypeReference last = i32Type;
+                    // the stack can only run dry in unreachable code after a branch, which the JIT never imports.
+                    for (; i > 0 && top.Count > 0; i--)
+                        last = top.Pop();
+                    return last;
+                }
+
+                // pushes the results of a call, spreading a multi-value tuple over the stack.
+                void pushResult(TypeReference type)
+                {
+                    if (!isTuple(type))
                     {
-                        top.Pop();
-                        i--;
+                        push(type);
+                        return;
                     }
 
-                    return top.Pop();
+                    var clrType = refToType(type);
+                    var tuple = getVariable(type);
+                    il.Emit(IlInstr.Stloc, tuple);
+                    var items = ((GenericInstanceType) type).GenericArguments;
+                    for (int k = 0; k < items.Count; k++)
+                    {
+                        il.Emit(IlInstr.Ldloca, tuple);
+                        il.Emit(IlInstr.Ldfld, def.MainModule.ImportReference(clrType.GetField("Item" + (k + 1))));
+                        push(valueType(items[k]));
+                    }
                 }
 
-                var start = reader.Position + 1;
-                while (next > reader.Position)
+                void emitReturn()
                 {
-                    var instr = (instr) reader.ReadU8();
+                    if (isTuple(ftype.ReturnType))
+                        il.Emit(IlInstr.Newobj,
+                            def.MainModule.ImportReference(refToType(ftype.ReturnType).GetConstructors()[0]));
+                    il.Emit(IlInstr.Ret);
+                }
+
+                void restore(LabelType block)
+                {
+                    top.Clear();
+                    for (int k = block.Entry.Length - 1; k >= 0; k--)
+                        top.Push(block.Entry[k]);
+                }
+
+                LabelType enterBlock(LabelType block)
+                {
+                    var entry = top.ToArray();
+                    block.Entry = entry.Skip(block.Params.Length).ToArray();
+                    labelStack.Add(block);
+                    return block;
+                }
+
+                // wasm discards whatever is below the operands of a branch, while IL requires the stack at the
+                // target to match. Extra values are rare, so they are only removed when there are any.
+                bool needsUnwind(LabelType target) =>
+                    top.Count > target.Entry.Length + target.BranchTypes.Length;
 
-                    TypeReference instrType()
+                void emitBranch(LabelType target)
+                {
+                    if (needsUnwind(target))
                     {
-                        var s = instr.ToString();
-                        if (s.Contains("F32")) return f32Type;
-                        if (s.Contains("F64")) return f64Type;
-                        if (s.Contains("I32")) return i32Type;
-                        if (s.Contains("I64")) return i64Type;
-                        return voidType;
+                        var types = target.BranchTypes;
+                        for (int k = types.Length - 1; k >= 0; k--)
+                            il.Emit(IlInstr.Stloc, getVariable(types[k], k));
+                        for (int k = top.Count - target.Entry.Length - types.Length; k > 0; k--)
+                            il.Emit(IlInstr.Pop);
+                        for (int k = 0; k < types.Length; k++)
+                            il.Emit(IlInstr.Ldloc, getVariable(types[k], k));
                     }
 
+                    if (target == labelStack[0])
+                        emitReturn();
+                    else
+                        il.Emit(IlInstr.Br, target.BranchLabel);
+                }
+
+                LabelType branchTarget(uint depth) => labelStack[(int) (labelStack.Count - depth - 1)];
+
+                var start = reader.Position + 1;
+                while (next > reader.Position)
+                {
+                    var instr = (instr) reader.ReadU8();
+
                     Type instrType2(bool unsigned = false)
                     {
                         var s = instr.ToString();
@@ -722,7 +1071,8 @@ namespace Wasm2Il
                             var otherFun = resolveMethod(fcn);
                             if (otherFun == null)
                                 throw new Exception("");
-                            if (otherFun.DeclaringType?.Name == nameof(Wasi))
+                            var withContext = takesContext(otherFun);
+                            if (withContext)
                             {
                                 il.Emit(IlInstr.Ldtoken, cls);
                                 il.Emit(IlInstr.Call,
@@ -731,7 +1081,7 @@ namespace Wasm2Il
                             }
 
                             il.Emit(IlInstr.Call, otherFun);
-                            if (otherFun.DeclaringType?.Name == nameof(Wasi))
+                            if (withContext)
                             {
                                 pop(otherFun.Parameters.Count - 1);
                             }
@@ -740,7 +1090,7 @@ namespace Wasm2Il
                                 pop(otherFun.Parameters.Count);
                             }
 
-                            push(otherFun.ReturnType);
+                            pushResult(otherFun.ReturnType);
                             break;
                         case instr.CALL_INDIRECT:
                             var typeidx = reader.ReadU32Leb();
@@ -762,56 +1112,103 @@ namespace Wasm2Il
                             il.Emit(IlInstr.Ldloc, getVariable(i32Type));
                             var funct = typeToFunc(ftp);
 
-                            il.Emit(IlInstr.Ldelem_Any, def.MainModule.TypeSystem.Object);
-                            il.Emit(IlInstr.Castclass, def.MainModule.ImportReference(funct));
+                            var callTarget = new GenericInstanceMethod(
+                                def.MainModule.ImportReference(typeof(Traps).GetMethod(nameof(Traps.CallTarget))));
+                            callTarget.GenericArguments.Add(def.MainModule.ImportReference(funct));
+                            il.Emit(IlInstr.Call, callTarget);
                             for (int i2 = 0; i2 < ftp.ParamCount; i2++)
                                 il.Emit(IlInstr.Ldloc, getVariable(ftp.ParamTypes[i2], i2 + 1));
                             var invoke = funct.GetMethod("Invoke");
                             il.Emit(IlInstr.Callvirt, def.MainModule.ImportReference(invoke));
-                            pop((int) ftp.ParamCount);
-                            push(ftp.ReturnType);
+                            pop((int) ftp.ParamCount + 1);
+                            pushResult(ftp.ReturnType);
                             break;
                         case instr.BLOCK:
-                            var blockType = reader.ReadU8();
+                            var (blockParams, blockResults) = readBlockType(reader);
                             var endLabel = il.Create(OpCodes.Nop);
-                            var blk = new LabelType
-                                {Type = blockType, EndLabel = endLabel, StartLabel = endLabel, Forward = true};
-                            labelStack.Add(blk);
+                            enterBlock(new LabelType
+                            {
+                                Params = blockParams, Results = blockResults, EndLabel = endLabel
+                            });
                             break;
                         case instr.LOOP:
-                            blockType = reader.ReadU8();
+                            (blockParams, blockResults) = readBlockType(reader);
                             var startLabel = il.Create(OpCodes.Nop);
                             il.Append(startLabel);
-                            blk = new LabelType {Type = blockType, EndLabel = null, StartLabel = startLabel};
-                            labelStack.Add(blk);
+                            if (counter != null)
+                                emitCount(il, counter);
+                            enterBlock(new LabelType
+                            {
+                                Params = blockParams, Results = blockResults, StartLabel = startLabel, IsLoop = true
+                            });
+                            break;
+                        case instr.IF:
+                            (blockParams, blockResults) = readBlockType(reader);
+                            pop();
+                            endLabel = il.Create(OpCodes.Nop);
+                            var blk = enterBlock(new LabelType
+                            {
+                                Params = blockParams, Results = blockResults, EndLabel = endLabel,
+                                ElseLabel = il.Create(OpCodes.Nop)
+                            });
+                            // the then branch is the fall through path, only the else branch is jumped to.
+                            il.Emit(OpCodes.Brfalse, blk.ElseLabel);
+                            break;
+                        case instr.ELSE:
+                            blk = labelStack.Last();
+                            if (!isUnconditionalJump(il.Body.Instructions.Last()))
+                                il.Emit(OpCodes.Br, blk.EndLabel);
+                            il.Append(blk.ElseLabel);
+                            blk.ElseLabel = null;
+                            // the else branch starts from the stack the if was entered with.
+                            restore(blk);
+                            foreach (var p in blk.Params)
+                                push(p);
                             break;
                         case instr.BR:
+                            emitBranch(branchTarget(reader.ReadU32Leb()));
+                            break;
                         case instr.BR_IF:
+                            var target = branchTarget(reader.ReadU32Leb());
+                            pop();
+                            if (target != labelStack[0] && !needsUnwind(target))
+                            {
+                                il.Emit(OpCodes.Brtrue, target.BranchLabel);
+                                break;
+                            }
 
-                            var brindex = reader.ReadU32Leb();
-                            if (instr == instr.BR_IF)
-                                il.Emit(OpCodes.Brtrue, labelStack[(int) (labelStack.Count - brindex - 1)].StartLabel);
-                            else
-                                il.Emit(OpCodes.Br, labelStack[(int) (labelStack.Count - brindex - 1)].StartLabel);
+                            var notTaken = il.Create(OpCodes.Nop);
+                            il.Emit(OpCodes.Brfalse, notTaken);
+                            emitBranch(target);
+                            il.Append(notTaken);
                             break;
                         case instr.BR_TABLE:
                             var cnt = reader.ReadU32Leb();
-                            var items = new Instruction[cnt];
+                            pop();
+                            var targets = new LabelType[cnt];
                             for (int i2 = 0; i2 < cnt; i2++)
+                                targets[i2] = branchTarget(reader.ReadU32Leb());
+                            var defaultTarget = branchTarget(reader.ReadU32Leb());
+
+                            // targets that need more than a jump get a stub after the default branch.
+                            var stubs = new Dictionary<LabelType, Instruction>();
+                            Instruction tableLabel(LabelType t)
                             {
-                                var brindex2 = reader.ReadU32Leb();
-                                var brindex3 = (int) (labelStack.Count - brindex2 - 1);
-                                items[i2] = labelStack[brindex3].StartLabel;
+                                if (t != labelStack[0] && !needsUnwind(t))
+                                    return t.BranchLabel!;
+                                if (!stubs.TryGetValue(t, out var stub))
+                                    stubs[t] = stub = il.Create(OpCodes.Nop);
+                                return stub;
                             }
 
-                            var defaultLabelIndex = reader.ReadU32Leb();
-                            var defaultLabel = labelStack[(int) (labelStack.Count - defaultLabelIndex - 1)].StartLabel;
-                            il.Emit(OpCodes.Switch, items);
-                            if (defaultLabel == null)
-                                throw new Exception("Unexpected situation");
-                            il.Emit(OpCodes.Br, defaultLabel);
+                            emitSwitch(il, targets, defaultTarget, tableLabel);
+                            emitBranch(defaultTarget);
+                            foreach (var stub in stubs)
+                            {
+                                il.Append(stub.Value);
+                                emitBranch(stub.Key);
+                            }
 
-                            pop();
                             break;
                         case instr.SELECT:
                             // select(a,b,c) = a ? b : c
@@ -984,18 +1381,25 @@ namespace Wasm2Il
                             }
 
                             il.Emit(IlInstr.Stloc, heapaddr);
+                            pop();
 
+                            // get the address of the accessed bytes; Access checks the unsigned effective address
+                            // and the access size against the memory.
+                            var accessSize = instr switch
+                            {
+                                instr.I32_LOAD8_S or instr.I32_LOAD8_U or instr.I64_LOAD8_S or instr.I64_LOAD8_U
+                                    or instr.I32_STORE_8 or instr.I64_STORE_8 => 1,
+                                instr.I32_LOAD16_S or instr.I32_LOAD16_U or instr.I64_LOAD16_S
+                                    or instr.I64_LOAD16_U or instr.I32_STORE_16 or instr.I64_STORE_16 => 2,
+                                instr.I64_LOAD or instr.F64_LOAD or instr.I64_STORE or instr.F64_STORE => 8,
+                                _ => 4
+                            };
                             il.Emit(IlInstr.Ldsfld, memoryField);
                             il.Emit(IlInstr.Ldloc, heapaddr);
-                            // adjust according to the offset 
-                            if (offset != 0)
-                            {
-                                il.Emit(IlInstr.Ldc_I8, offset);
-                                il.Emit(IlInstr.Add);
-                            }
-
-                            // get the address of element N (pop the address from the stack)
-                            il.Emit(IlInstr.Ldelema, def.MainModule.TypeSystem.Byte);
+                            il.Emit(IlInstr.Ldc_I4, (int) offset);
+                            il.Emit(IlInstr.Ldc_I4, accessSize);
+                            il.Emit(IlInstr.Call, getMethod(typeof(Traps), nameof(Traps.Access), typeof(byte[]),
+                                typeof(int), typeof(uint), typeof(int)));
                             switch (instr)
                             {
                                 // pop address, value. store value in address according to size.
@@ -1143,31 +1547,19 @@ namespace Wasm2Il
                             push(f32Type);
                             break;
 
+                        // conv.ovf would report NaN as an overflow, the helpers trap with the right kind.
                         case instr.I32_TRUNC_F32_S:
+                        case instr.I32_TRUNC_F64_S:
                         case instr.I32_TRUNC_F32_U:
-                            il.Emit(IlInstr.Conv_I4);
-                            pop(1);
-                            push(i32Type);
-                            break;
                         case instr.I32_TRUNC_F64_U:
-                            il.Emit(IlInstr.Conv_U4);
-                            pop(1);
-                            push(i32Type);
-                            goto case instr.I32_TRUNC_F64_S;
-                        case instr.I32_TRUNC_F64_S:
-                            il.Emit(IlInstr.Conv_I4);
-                            pop(1);
-                            push(i32Type);
-                            break;
-                        case instr.I64_TRUNC_F64_U:
-                            il.Emit(IlInstr.Conv_U8);
-                            pop(1);
-                            push(i64Type);
-                            goto case instr.I64_TRUNC_F64_S;
+                        case instr.I64_TRUNC_F32_S:
                         case instr.I64_TRUNC_F64_S:
-                            il.Emit(IlInstr.Conv_I8);
+                        case instr.I64_TRUNC_F32_U:
+                        case instr.I64_TRUNC_F64_U:
+                            var truncArg = instr.ToString().Contains("F32") ? typeof(float) : typeof(double);
+                            il.Emit(IlInstr.Call, getMethod(typeof(Conversions), helperName(instr), truncArg));
                             pop(1);
-                            push(i64Type);
+                            push(instr.ToString().StartsWith("I32") ? i32Type : i64Type);
                             break;
                         case instr.F32_CONVERT_I32_S:
                         case instr.F32_CONVERT_I32_U:
@@ -1211,10 +1603,17 @@ namespace Wasm2Il
                             il.Emit(IlInstr.Mul);
                             pop();
                             break;
-                        case instr.F32_DIV:
-                        case instr.F64_DIV:
                         case instr.I32_DIV_S:
                         case instr.I64_DIV_S:
+                        case instr.I32_REM_S:
+                        case instr.I64_REM_S:
+                            // the peephole pass replaces the call with div/rem when the divisor is a safe constant.
+                            il.Emit(IlInstr.Call, getMethod(typeof(Division), helperName(instr),
+                                instrType2(), instrType2()));
+                            pop();
+                            break;
+                        case instr.F32_DIV:
+                        case instr.F64_DIV:
                             il.Emit(IlInstr.Div);
                             pop();
                             break;
@@ -1223,11 +1622,6 @@ namespace Wasm2Il
                             il.Emit(IlInstr.Div_Un);
                             pop();
                             break;
-                        case instr.I32_REM_S:
-                        case instr.I64_REM_S:
-                            il.Emit(IlInstr.Rem);
-                            pop();
-                            break;
                         case instr.I32_REM_U:
                         case instr.I64_REM_U:
                             il.Emit(IlInstr.Rem_Un);
@@ -1274,24 +1668,16 @@ namespace Wasm2Il
                         case instr.I64_LE_U:
                         case instr.F64_LE:
                         case instr.F32_LE:
-                            var unsigned = instr.ToString().Contains("_U");
+                            // a <= b is !(a > b). For floats the unordered compare makes NaN operands false,
+                            // and for unsigned integers it is the unsigned compare.
                             var le = instr.ToString().Contains("LE");
-                            OpCode cmp = le ? IlInstr.Clt : IlInstr.Cgt;
-                            if (unsigned)
-                                cmp = le ? IlInstr.Clt_Un : IlInstr.Cgt_Un;
-
-                            var v = getVariable(instrType());
-                            var v2 = getVariable(instrType(), 1);
-                            il.Emit(IlInstr.Stloc, v);
-                            il.Emit(IlInstr.Stloc, v2);
-                            il.Emit(IlInstr.Ldloc, v2);
-                            il.Emit(IlInstr.Ldloc, v);
+                            var unordered = instr.ToString().Contains("_U") || instr.ToString().StartsWith("F");
+                            if (unordered)
+                                il.Emit(le ? IlInstr.Cgt_Un : IlInstr.Clt_Un);
+                            else
+                                il.Emit(le ? IlInstr.Cgt : IlInstr.Clt);
+                            il.Emit(IlInstr.Ldc_I4_0);
                             il.Emit(IlInstr.Ceq);
-                            il.Emit(IlInstr.Ldloc, v2);
-                            il.Emit(IlInstr.Ldloc, v);
-
-                            il.Emit(cmp);
-                            il.Emit(IlInstr.Or);
                             pop(2);
                             push(i32Type);
                             break;
@@ -1357,6 +1743,7 @@ namespace Wasm2Il
                         case instr.F64_COPYSIGN:
                         case instr.F32_COPYSIGN:
                             var vtype = is64 ? f64Type : f32Type;
+                            pop();
                             il.Emit(IlInstr.Stloc, getVariable(vtype));
                             il.Emit(IlInstr.Stloc, getVariable(vtype, 1));
                             il.Emit(IlInstr.Ldloc, getVariable(vtype));
@@ -1454,13 +1841,62 @@ namespace Wasm2Il
                                 il.Emit(IlInstr.Conv_I8);
                             break;
                         case instr.UNREACHABLE:
-                            il.Emit(IlInstr.Ldstr, "Unreachable code");
-                            il.Emit(IlInstr.Newobj, resolveTypeConstructor(typeof(Exception), typeof(string)));
+                            il.Emit(IlInstr.Call, getMethod(typeof(Traps), nameof(Traps.Unreachable)));
                             il.Emit(IlInstr.Throw);
                             break;
 
                         case instr.RETURN:
-                            il.Emit(IlInstr.Ret);
+                            emitBranch(labelStack[0]);
+                            break;
+                        case instr.PREFIX_FC:
+                            var fc = (Wasm.PrefixFC) reader.ReadU32Leb();
+                            switch (fc)
+                            {
+                                case Wasm.PrefixFC.MEMORY_COPY:
+                                    reader.ReadU8(); // destination and source memory, always 0.
+                                    reader.ReadU8();
+                                    il.Emit(IlInstr.Ldsfld, memoryField);
+                                    il.Emit(IlInstr.Call, getMethod(typeof(BulkMemory), nameof(BulkMemory.Copy),
+                                        typeof(int), typeof(int), typeof(int), typeof(byte[])));
+                                    pop(3);
+                                    break;
+                                case Wasm.PrefixFC.MEMORY_FILL:
+                                    reader.ReadU8();
+                                    il.Emit(IlInstr.Ldsfld, memoryField);
+                                    il.Emit(IlInstr.Call, getMethod(typeof(BulkMemory), nameof(BulkMemory.Fill),
+                                        typeof(int), typeof(int), typeof(int), typeof(byte[])));
+                                    pop(3);
+                                    break;
+                                case Wasm.PrefixFC.MEMORY_INIT:
+                                    var segment = reader.ReadU32Leb();
+                                    reader.ReadU8();
+                                    emitLoadSegment(il, segment);
+                                    il.Emit(IlInstr.Ldsfld, memoryField);
+                                    il.Emit(IlInstr.Call, getMethod(typeof(BulkMemory), nameof(BulkMemory.Init),
+                                        typeof(int), typeof(int), typeof(int), typeof(byte[]), typeof(byte[])));
+                                    pop(3);
+                                    break;
+                                case Wasm.PrefixFC.DATA_DROP:
+                                    segment = reader.ReadU32Leb();
+                                    // active segments are already dropped after instantiation.
+                                    if (dataSegments.TryGetValue(segment, out var segmentField))
+                                    {
+                                        emitEmptyBytes(il);
+                                        il.Emit(IlInstr.Stsfld, segmentField);
+                                    }
+                                    break;
+                                case <= Wasm.PrefixFC.I64_TRUNC_SAT_F64_U:
+                                    var satArg = fc.ToString().Contains("F32") ? typeof(float) : typeof(double);
+                                    il.Emit(IlInstr.Call, getMethod(typeof(Conversions), helperName(fc), satArg));
+                                    pop(1);
+                                    push(fc.ToString().StartsWith("I32") ? i32Type : i64Type);
+                                    break;
+                                default:
+                                    throw new Exception("Unsupported instruction: " + instr + " " + fc);
+                            }
+                            break;
+                        case instr.PREFIX_FD:
+                            emitSimd(il, (Wasm.PrefixFD) reader.ReadU32Leb(), reader, pop, push);
                             break;
                         case instr.DROP:
                             il.Emit(IlInstr.Pop);
@@ -1472,14 +1908,19 @@ namespace Wasm2Il
                                 var r = labelStack.Last();
                                 labelStack.RemoveAt(labelStack.Count - 1);
 
+                                if (r.ElseLabel != null)
+                                    il.Append(r.ElseLabel);
                                 if (r.EndLabel != null)
                                     il.Append(r.EndLabel);
+                                restore(r);
+                                foreach (var result in r.Results)
+                                    push(result);
                             }
                             else
                             {
                                 labelStack.RemoveAt(0);
-                                if (il.Body.Instructions.Last().OpCode != IlInstr.Ret)
-                                    il.Emit(IlInstr.Ret);
+                                if (!isUnconditionalJump(il.Body.Instructions.Last()))
+                                    emitReturn();
                                 goto next;
                             }
 
@@ -1492,14 +1933,133 @@ namespace Wasm2Il
                 if (labelStack.Count > 0)
                 {
                     Assert.IsTrue(labelStack.Count == 1);
-                    if (il.Body.Instructions.Last().OpCode != IlInstr.Ret)
-                        il.Emit(IlInstr.Ret);
+                    if (!isUnconditionalJump(il.Body.Instructions.Last()))
+                        emitReturn();
+                }
+
+                next:
+                optimize(m1.Body, isHot(m1));
+            }
+
+            inlineLeaves();
+        }
+
+        static bool isUnconditionalJump(Instruction i) =>
+            i.OpCode == OpCodes.Br || i.OpCode == OpCodes.Ret || i.OpCode == OpCodes.Throw;
+
+        // runs of at least this many entries going to the default target split a br_table into several switches.
+        const int sparseTableGap = 16;
+
+        /// <summary>
+        /// Emits the switch part of a br_table, leaving the index consumed. Entries that go to the default target
+        /// at either end of the table are left out, as the switch falls through for them anyway, and long runs of
+        /// them in the middle split the table into range checked switches so sparse tables stay small.
+        /// </summary>
+        void emitSwitch(ILProcessor il, LabelType[] targets, LabelType defaultTarget, Func<LabelType, Instruction> label)
+        {
+            var segments = new List<(int Start, int End)>();
+            int k = 0;
+            while (k < targets.Length)
+            {
+                if (targets[k] == defaultTarget)
+                {
+                    k++;
+                    continue;
                 }
 
-                next: ;
+                // extend the segment until a long enough run of default entries.
+                var start = k;
+                var end = k + 1;
+                for (k++; k < targets.Length && k - end < sparseTableGap; k++)
+                    if (targets[k] != defaultTarget)
+                        end = k + 1;
+                segments.Add((start, end));
+                k = end;
+            }
+
+            if (segments.Count == 0)
+            {
+                il.Emit(OpCodes.Pop);
+                return;
+            }
+
+            var index = segments.Count > 1 ? new VariableDefinition(i32Type) : null;
+            if (index != null)
+            {
+                il.Body.Variables.Add(index);
+                il.Emit(OpCodes.Stloc, index);
+            }
+
+            foreach (var (start, end) in segments)
+            {
+                if (index != null)
+                    il.Emit(OpCodes.Ldloc, index);
+                // an index below the segment wraps around and is out of range for the unsigned switch.
+                if (start > 0)
+                {
+                    il.Emit(OpCodes.Ldc_I4, start);
+                    il.Emit(OpCodes.Sub);
+                }
+
+                il.Emit(OpCodes.Switch, targets[start..end].Select(label).ToArray());
             }
         }
 
+        /// <summary>
+        /// Block, loop and if labels are emitted as nops, and blocks that end in a branch leave jumps to jumps.
+        /// Every branch is retargeted to the final instruction it reaches, jumps to a return become returns and
+        /// jumps to the next instruction are dropped, so the JIT sees one direct branch per transfer.
+        /// </summary>
+        static void optimizeBranches(Mono.Cecil.Cil.MethodBody body)
+        {
+            Instruction skipLabels(Instruction i)
+            {
+                while (i.OpCode == OpCodes.Nop && i.Next != null)
+                    i = i.Next;
+                return i;
+            }
+
+            Instruction resolve(Instruction i)
+            {
+                i = skipLabels(i);
+                // bounded, as an empty infinite loop jumps to itself.
+                for (int hops = 0; hops < 16 && i.OpCode == OpCodes.Br; hops++)
+                    i = skipLabels((Instruction) i.Operand);
+                return i;
+            }
+
+            var instructions = body.Instructions;
+            foreach (var i in instructions)
+            {
+                if (i.Operand is Instruction target)
+                    i.Operand = resolve(target);
+                else if (i.Operand is Instruction[] targets)
+                    for (int k = 0; k < targets.Length; k++)
+                        targets[k] = resolve(targets[k]);
+            }
+
+            foreach (var i in instructions)
+            {
+                if (i.OpCode != OpCodes.Br)
+                    continue;
+                var target = (Instruction) i.Operand;
+                if (target.OpCode == OpCodes.Ret)
+                {
+                    // the stack at a branch matches its target, so it holds exactly the return value.
+                    i.OpCode = OpCodes.Ret;
+                    i.Operand = null;
+                }
+                else if (i.Next != null && resolve(i.Next) == target)
+                {
+                    i.OpCode = OpCodes.Nop;
+                    i.Operand = null;
+                }
+            }
+
+            for (int k = instructions.Count - 2; k >= 0; k--)
+                if (instructions[k].OpCode == OpCodes.Nop)
+                    instructions.RemoveAt(k);
+        }
 
         void ReadExportSection(BinReader reader)
         {
@@ -1543,6 +2103,107 @@ namespace Wasm2Il
         }
 
 
+        /// <summary>
+        /// Name of the runtime helper implementing a prefixed instruction, I32X4_EXTRACT_LANE -> I32x4ExtractLane.
+        /// </summary>
+        static string helperName(Enum op) =>
+            string.Concat(op.ToString().Split('_').Select(x => x[0] + x.Substring(1).ToLower()));
+
+        TypeReference simdType(Type t)
+        {
+            if (t == typeof(Vector128<byte>)) return v128Type;
+            if (t == typeof(int)) return i32Type;
+            if (t == typeof(long)) return i64Type;
+            if (t == typeof(float)) return f32Type;
+            if (t == typeof(double)) return f64Type;
+            return voidType;
+        }
+
+        /// <summary>
+        /// Emits a SIMD instruction as a call to the Simd method of the same name. Immediates are passed as
+        /// constant arguments after the operands, which the JIT folds when the call is inlined.
+        /// </summary>
+        void emitSimd(ILProcessor il, Wasm.PrefixFD op, BinReader reader, Func<int, TypeReference> pop,
+            Action<TypeReference> push)
+        {
+            var name = helperName(op);
+            var method = typeof(Simd).GetMethod(name, BindingFlags.Static | BindingFlags.Public)
+                         ?? throw new Exception("Unsupported SIMD instruction: " + op);
+            var operands = method.GetParameters().Length;
+            switch (op)
+            {
+                case Wasm.PrefixFD.V128_CONST:
+                    il.Emit(OpCodes.Ldc_I8, reader.ReadI64());
+                    il.Emit(OpCodes.Ldc_I8, reader.ReadI64());
+                    operands = 0;
+                    break;
+                case Wasm.PrefixFD.I8X16_SHUFFLE:
+                    // the lane indices are passed as a vector constant.
+                    il.Emit(OpCodes.Ldc_I8, reader.ReadI64());
+                    il.Emit(OpCodes.Ldc_I8, reader.ReadI64());
+                    il.Emit(OpCodes.Call, def.MainModule.ImportReference(typeof(Simd).GetMethod(nameof(Simd.V128Const))));
+                    operands -= 1;
+                    break;
+                default:
+                    // loads and stores carry a memarg; the lane loads and stores follow it with a lane index, which
+                    // is passed before the offset.
+                    var memory = name.StartsWith("V128Load") || name.StartsWith("V128Store");
+                    uint offset = 0;
+                    if (memory)
+                    {
+                        reader.ReadU32Leb(); // alignment
+                        offset = reader.ReadU32Leb();
+                    }
+
+                    if (name.Contains("Lane"))
+                    {
+                        il.Emit(OpCodes.Ldc_I4, (int) reader.ReadU8());
+                        operands -= 1;
+                    }
+
+                    if (memory)
+                    {
+                        il.Emit(OpCodes.Ldc_I4, (int) offset);
+                        il.Emit(OpCodes.Ldsfld, memoryField);
+                        operands -= 2;
+                    }
+
+                    break;
+            }
+
+            il.Emit(OpCodes.Call, def.MainModule.ImportReference(method));
+            pop(operands);
+            push(simdType(method.ReturnType));
+        }
+
+        /// <summary>
+        /// The CLR return type for a list of wasm results. Several results are returned as a ValueTuple.
+        /// </summary>
+        TypeReference resultType(TypeReference[] results)
+        {
+            if (results.Length == 0) return voidType;
+            if (results.Length == 1) return results[0];
+            if (results.Length > 7) throw new Exception("More than 7 results are not supported");
+            return def.MainModule.ImportReference(tupleType(results.Select(refToType).ToArray()));
+        }
+
+        static Type tupleType(Type[] items) => Type.GetType("System.ValueTuple`" + items.Length)!.MakeGenericType(items);
+
+        static bool isTuple(TypeReference t) =>
+            t is GenericInstanceType g && g.ElementType.FullName.StartsWith("System.ValueTuple`");
+
+        (TypeReference[] Params, TypeReference[] Results) readBlockType(BinReader reader)
+        {
+            // an empty type, a single value type, or an index into the type section.
+            var blockType = reader.ReadI64Leb();
+            if (blockType == -0x40)
+                return (Array.Empty<TypeReference>(), Array.Empty<TypeReference>());
+            if (blockType < 0)
+                return (Array.Empty<TypeReference>(), new[] {ByteToTypeReference((byte) (blockType & 0x7F))});
+            var type = Types[(uint) blockType];
+            return (type.ParamTypes, type.ReturnTypes);
+        }
+
         TypeReference ByteToTypeReference(byte b)
         {
             switch (b)
@@ -1551,6 +2212,7 @@ namespace Wasm2Il
                 case 0x7E: return def.MainModule.TypeSystem.Int64;
                 case 0x7D: return def.MainModule.TypeSystem.Single;
                 case 0x7C: return def.MainModule.TypeSystem.Double;
+                case 0x7B: return v128Type;
                 default:
                     throw new Exception("Invalid type " + b);
             }
@@ -1734,13 +2396,13 @@ namespace Wasm2Il
                 }
 
                 var returnCount = reader.ReadU32Leb();
-                Assert.IsTrue(returnCount < 2);
-                TypeReference returnType = def.MainModule.TypeSystem.Void;
+                var returnTypes = new TypeReference[returnCount];
                 for (int i2 = 0; i2 < returnCount; i2++)
-                    returnType = ByteToTypeReference(reader.ReadU8());
+                    returnTypes[i2] = ByteToTypeReference(reader.ReadU8());
                 Types[i] = new TypeId
                 {
-                    ReturnCount = returnCount, ParamCount = paramCount, ParamTypes = paramTypes, ReturnType = returnType
+                    ReturnCount = returnCount, ParamCount = paramCount, ParamTypes = paramTypes,
+                    ReturnTypes = returnTypes, ReturnType = resultType(returnTypes)
                 };
             }
         }
@@ -1,4 +1,5 @@
 using System.Diagnostics;
+using System.Linq.Expressions;
 using System.Reflection;
 using System.Runtime.CompilerServices;
 using System.Runtime.InteropServices;
@@ -13,13 +14,68 @@ public class Wasi
 {
     public class Context
     {
-        public Dictionary<int, FileStream> fds = new Dictionary<int, FileStream>();
-        public Dictionary<int, DirectoryInfo> dirs = new Dictionary<int, DirectoryInfo>();
-        public byte[] Memory => (byte[])t.GetField("Memory", BindingFlags.Static | BindingFlags.NonPublic).GetValue(null);
+        public readonly FdTable Fds = new FdTable();
+        public readonly WasiPoll Poll = new WasiPoll();
+        public readonly WasiRandom Random = new WasiRandom(Options.RandomSeed);
+        public readonly Utf8StringCache Strings = new Utf8StringCache();
+
+        /// <summary>
+        /// The module's linear memory. Read through a compiled accessor, since memory.grow replaces the array.
+        /// </summary>
+        public byte[] Memory => memory();
+
         private Type t;
+        readonly Func<byte[]> memory;
+
         public Context(RuntimeTypeHandle rt)
         {
             t = Type.GetTypeFromHandle(rt);
+            var memoryField = t.GetField("Memory", BindingFlags.Static | BindingFlags.NonPublic);
+            memory = memoryField == null
+                ? Array.Empty<byte>
+                : Expression.Lambda<Func<byte[]>>(Expression.Field(null, memoryField)).Compile();
+            if (Options.CoarseClockInterval is { } interval)
+                WasiClock.EnableCoarseClock(interval);
+            var bufferSize = Options.OutputBufferSize;
+            Fds.Insert(0, new FdEntry
+            {
+                FileType = __wasi_filetype_t.CharacterDevice, Stream = Options.Stdin ?? Console.OpenStandardInput(),
+                HostFd = Options.Stdin == null ? 0 : -1
+            });
+            Fds.Insert(1, new FdEntry
+            {
+                FileType = __wasi_filetype_t.CharacterDevice,
+                Stream = stdout = new BufferedStream(Options.Stdout ?? Console.OpenStandardOutput(), bufferSize)
+            });
+            Fds.Insert(2, new FdEntry
+            {
+                FileType = __wasi_filetype_t.CharacterDevice,
+                Stream = stderr = new BufferedStream(Options.Stderr ?? Console.OpenStandardError(), bufferSize)
+            });
+            foreach (var preopen in Options.GetPreopens())
+            {
+                var fs = preopen.FileSystem ?? HostFileSystem.Instance;
+                var root = fs.Combine(preopen.HostPath, ".");
+                Fds.Allocate(new FdEntry
+                {
+                    FileType = __wasi_filetype_t.Directory, Path = root, Root = root, PreopenName = preopen.GuestPath,
+                    FileSystem = fs
+                });
+            }
+        }
+
+        readonly BufferedStream stdout, stderr;
+
+        /// <summary>
+        /// Writes out anything buffered for stdout and stderr.
+        /// </summary>
+        public void Flush()
+        {
+            // the guest may have closed them.
+            if (stdout.CanWrite)
+                stdout.Flush();
+            if (stderr.CanWrite)
+                stderr.Flush();
         }
 
         public object Call(string method, params object[] args)
@@ -28,89 +84,123 @@ public class Wasi
             return x.Invoke(null, args);
         }
 
-        private Dictionary<string, int> inodes = new Dictionary<string, int>();
-        private int inodesCounter = 5;
+        readonly Dictionary<string, Delegate> functions = new Dictionary<string, Delegate>();
 
-        public int InodeForFile(string fileName)
+        /// <summary>
+        /// A delegate to a function of the module, created once per name. Much cheaper than Call for
+        /// functions the host calls repeatedly.
+        /// </summary>
+        public T GetFunction<T>(string name) where T : Delegate
         {
-            if(inodes.TryGetValue(fileName, out var inode))
-                return inode;
-            return inodes[fileName] = inodesCounter++;
-
+            if (!functions.TryGetValue(name, out var d))
+                functions[name] = d = t.GetMethod(name)!.CreateDelegate<T>();
+            return (T) d;
         }
 
-        public object LookupFd(int fd)
-        {
-            if (dirs.TryGetValue(fd, out var dir))
-                return dir;
-            return GetFdStream(fd);
-        }
+        public FdEntry? LookupFd(int fd) => Fds[fd];
 
-        Stream? stdout;
-        public Stream GetFdStream(int fd)
-        {
-            if (fd == 1)
-            {
-                return stdout ??= Console.OpenStandardOutput();
-            }
+        public Stream? GetFdStream(int fd) => Fds[fd]?.Stream;
 
-            if (fd == 2)
-            {
-                return Console.OpenStandardInput();
-            }
+        const int maxResolvedPaths = 1024;
 
-            if (fds.TryGetValue(fd, out var str))
-                return str;
-            return null;
+        /// <summary>
+        /// Resolves a guest path relative to a directory fd into a path inside that directory's preopen.
+        /// </summary>
+        public Error ResolvePath(int dirFd, string path, out string hostPath, out FdEntry? dir)
+        {
+            hostPath = "";
+            dir = LookupFd(dirFd);
+            if (dir == null)
+                return Error.Badf;
+            if (!dir.IsDirectory)
+                return Error.Notdir;
+
+            var cache = dir.ResolvedPaths ??= new Dictionary<string, string>();
+            if (cache.TryGetValue(path, out hostPath!))
+                return Error.Success;
+
+            var full = dir.FileSystem.Combine(dir.Path!, path);
+            var root = dir.Root ?? dir.Path!;
+            if (!isInside(full, root))
+                return Error.Notcapable;
+            if (cache.Count >= maxResolvedPaths)
+                cache.Clear();
+            cache[path] = hostPath = full;
+            return Error.Success;
         }
 
-        
+        static bool isInside(string path, string root)
+        {
+            root = Path.TrimEndingDirectorySeparator(root);
+            if (!path.StartsWith(root, StringComparison.Ordinal))
+                return false;
+            return path.Length == root.Length || Path.EndsInDirectorySeparator(root) ||
+                   Path.EndsInDirectorySeparator(path.AsSpan(0, root.Length + 1));
+        }
 
-        public int OpenFileOrDir(string pa)
+        public Error OpenFileOrDir(string pa, FdEntry parent, OFlags oflags, __wasi_rights_t rightsBase,
+            __wasi_rights_t rightsInheriting, FdFlags flags, out int fd)
         {
-            var dirinfo = new DirectoryInfo(pa);
-            if (dirinfo.Exists)
+            fd = -1;
+            var fs = parent.FileSystem;
+            var entry = new FdEntry
             {
-                for (int i = 1001; i < 2000; i++)
-                {
-                    if (dirs.ContainsKey(i) == false)
-                    {
-                        dirs[i] = dirinfo;
-                        return i;
-                    }
-                }
+                Path = pa, Root = parent.Root, FileSystem = fs, RightsBase = rightsBase,
+                RightsInheriting = rightsInheriting, Flags = flags
+            };
+            if (fs.GetFileType(pa) == __wasi_filetype_t.Directory)
+            {
+                if ((oflags & (OFlags.CREAT | OFlags.EXCL)) == (OFlags.CREAT | OFlags.EXCL))
+                    return Error.Exist;
+                entry.FileType = __wasi_filetype_t.Directory;
             }
-            var fst = File.Open(pa, FileMode.OpenOrCreate);
-            for (int i = 10; i < 1000; i++)
+            else
             {
-                if (fds.ContainsKey(i) == false)
-                {
-                    fds[i] = fst;
-                    return i;
-                }
+                if ((oflags & OFlags.DIRECTORY) != 0)
+                    return fs.GetFileType(pa) == __wasi_filetype_t.Unknown ? Error.NoEnt : Error.Notdir;
+                bool write = (rightsBase & __wasi_rights_t.FD_WRITE) != 0;
+                bool read = (rightsBase & __wasi_rights_t.FD_READ) != 0 || !write;
+                var access = write ? (read ? FileAccess.ReadWrite : FileAccess.Write) : FileAccess.Read;
+                var err = fs.Open(pa, oflags, access, out entry.Stream);
+                if (err != Error.Success)
+                    return err;
+                entry.FileType = __wasi_filetype_t.RegularFile;
             }
 
-            throw new Exception("Out of handles");
-
+            fd = Fds.Allocate(entry);
+            return Error.Success;
         }
 
-        public void CloseFd(int fd)
+        public bool CloseFd(int fd)
         {
-            if (fds.TryGetValue(fd, out var ctx))
-            {
-                ctx.Close();
-                fds.Remove(fd);
-            }
+            var entry = Fds.Remove(fd);
+            entry?.Close();
+            return entry != null;
         }
 
+        public ref T Ref<T>(int ptr) where T : unmanaged => ref new GuestPtr<T>(ptr).Deref(Memory);
+
+        public Span<T> Span<T>(int ptr, int count) where T : unmanaged => new GuestSpan<T>(ptr, count).Get(Memory);
+
+        /// <summary>
+        /// Reads a UTF-8 string from guest memory, zero terminated if no length is given.
+        /// Repeated strings come from a cache and do not allocate.
+        /// </summary>
         public string GetString(int ptr, int len = -1)
         {
+            var span = Memory.AsSpan(ptr);
+            if (len < 0)
+            {
+                len = span.IndexOf((byte) 0);
+                if (len < 0) len = span.Length;
+            }
 
-            if (len < 0) len = (int)Call("strlen", ptr);
-            return System.Text.Encoding.UTF8.GetString(Memory.AsSpan(ptr, len));
+            return Strings.Get(span.Slice(0, len));
         }
     }
 
+    public static WasiOptions Options = new WasiOptions();
+
     private static Dictionary<IntPtr, Context> contexts = new Dictionary<IntPtr, Context>(); 
     public static Context GetContext(RuntimeTypeHandle t)
     {
@@ -119,6 +209,32 @@ public class Wasi
         return contexts[t.Value] = new Context(t);
     }
 
+    static Wasi()
+    {
+        // buffered guest output must not be lost when the host goes away.
+        AppDomain.CurrentDomain.ProcessExit += (_, _) => FlushAll();
+        AppDomain.CurrentDomain.UnhandledException += (_, _) => FlushAll();
+    }
+
+    public static void FlushAll()
+    {
+        foreach (var ctx in contexts.Values.ToArray())
+            ctx.Flush();
+    }
+
+    /// <summary>
+    /// Thrown by proc_exit to unwind the guest back to the host.
+    /// </summary>
+    public class ProcExitException : Exception
+    {
+        public readonly int ExitCode;
+
+        public ProcExitException(int exitCode) : base("Guest exited with code " + exitCode)
+        {
+            ExitCode = exitCode;
+        }
+    }
+
     [Flags]
     public enum FileFlags : int
     {
@@ -127,23 +243,21 @@ public class Wasi
     }
     
     // intercept
-    public static int __wasilibc_open_nomode(int ptr, FileFlags flags, Context ctx)
+    public static int __wasilibc_open_nomode(int ptr, FileFlags flags, Func<int, int, int> original, Context ctx)
     {
-        string path = ctx.GetString(ptr);
-        var test = ctx.Call("__wasilibc_open_nomode_pre", ptr, (int)flags & 0xFFFF);
-        return (int)test;
+        return original(ptr, (int)flags & 0xFFFF);
     }
     
     public static void abort(Context ctx)
     {
-        ctx.Call("fflush", 0);
-        
+        ctx.GetFunction<Func<int, int>>("fflush")(0);
+        ctx.Flush();
         throw new Exception("Operation aborted");
     }
 
-    public static int testWrap(int x, Context ctx)
+    public static int testWrap(int x, Func<int, int> original, Context ctx)
     {
-        var test = ctx.Call("testWrap_pre", 0);
+        var test = original(0);
         Assert.AreEqual(test, 5);
         return 0;
     }
@@ -152,9 +266,9 @@ public class Wasi
     
     const int F_GETLK = 5;
     const int F_SETLK = 6;
-    public static int fcntl(int fd, int cmd, int args, Context ctx)
+    public static int fcntl(int fd, int cmd, int args, Func<int, int, int, int> original, Context ctx)
     {
-        ctx.Call("fflush", 0);
+        ctx.GetFunction<Func<int, int>>("fflush")(0);
         if (cmd == F_SETLK)
         {
             return 0;
@@ -164,8 +278,7 @@ public class Wasi
         {
             return 0;
         }
-        var test = ctx.Call("fcntl_pre", fd, cmd, args);
-        return (int)test;
+        return original(fd, cmd, args);
     }
 
     public enum __wasi_rights_t : ulong
@@ -246,31 +359,19 @@ public class Wasi
     }*/
     public static int fd_fdstat_get(int fd, int retptr0, Context context)
     {
-        var str = context.GetFdStream(fd);
-        
+        var entry = context.LookupFd(fd);
+        if (entry == null)
+            return (int) Error.Badf;
+
         __wasi_fdstat_t stat = new __wasi_fdstat_t()
         {
+            fs_filetype = entry.FileType,
+            fs_flags = entry.Flags,
+            fs_rights_base = entry.RightsBase,
+            fs_rights_inheriting = entry.RightsInheriting
         };
-        stat.fs_rights_base = __wasi_rights_t.ALL;
-        if (str is FileStream fstr2)
-        {
-            stat.fs_filetype = __wasi_filetype_t.RegularFile;
-        }
-        else if (str is Stream)
-        {
-            stat.fs_filetype = __wasi_filetype_t.CharacterDevice;
-        }else if (fd == 4)
-        {
-            stat.fs_filetype = __wasi_filetype_t.Directory;
-            stat.fs_rights_base = __wasi_rights_t.ALL;
-            stat.fs_rights_inheriting = __wasi_rights_t.ALL;
-        }
-        else
-        {
-            return -1;
-        }
-        
-        Unsafe.As<byte, __wasi_fdstat_t>(ref context.Memory[retptr0]) = stat;
+
+        context.Ref<__wasi_fdstat_t>(retptr0) = stat;
         return 0;
     }
 
@@ -298,19 +399,23 @@ public class Wasi
     
     public static int fd_write(int fd, int iov, int iov_len, int n_written, Context context)
     {
+        var entry = context.LookupFd(fd);
+        if (entry?.Stream == null)
+            return (int) Error.Badf;
+        if (!entry.HasRights(__wasi_rights_t.FD_WRITE))
+            return (int) Error.Notcapable;
+        var stream = entry.Stream;
+        if ((entry.Flags & FdFlags.APPEND) != 0 && stream.CanSeek)
+            stream.Seek(0, SeekOrigin.End);
         var memory = context.Memory;
         int written = 0;
-        for (int i = 0; i < iov_len; i++)
+        foreach (var p in new GuestSpan<ciovec_t>(iov, iov_len).Get(memory))
         {
-            ciovec_t p = Unsafe.Add(ref Unsafe.As<byte, ciovec_t>(ref memory[iov]), i);
             written += p.size;
-            var span = memory.AsSpan(p.bufptr, p.size);
-            var stream = context.GetFdStream(fd);
-            stream.Write(span);
-            
+            stream.Write(memory.AsSpan(p.bufptr, p.size));
         }
 
-        Unsafe.As<byte, uint>(ref memory[n_written]) = (uint) written;
+        new GuestPtr<uint>(n_written).Deref(memory) = (uint) written;
         
         return 0;
     }
@@ -321,14 +426,20 @@ public class Wasi
         return 0;
     }
 
-    public static int clock_res_get(int P_0, int P_1, Context context)
+    public static int clock_res_get(int clockId, int retptr0, Context context)
     {
-        throw new NotImplementedException("Not Implemented");
+        var err = WasiClock.GetResolution(clockId, out var resolution);
+        if (err == Error.Success)
+            context.Ref<ulong>(retptr0) = resolution;
+        return (int) err;
     }
 
-    public static int clock_time_get(int P_0, long P_1, int P_2, Context context)
+    public static int clock_time_get(int clockId, long precision, int retptr0, Context context)
     {
-        throw new NotImplementedException("Not Implemented");
+        var err = WasiClock.GetTime(clockId, (ulong) precision, out var time);
+        if (err == Error.Success)
+            context.Ref<ulong>(retptr0) = time;
+        return (int) err;
     }
 
     public static int fd_advise(int P_0, long P_1, long P_2, int P_3, Context context)
@@ -342,14 +453,10 @@ public class Wasi
     }
     public static int fd_close(int fd, Context context)
     {
-        context.CloseFd(fd);
-        return 0;
+        return context.CloseFd(fd) ? 0 : (int) Error.Badf;
     }
     
-    public static int fd_datasync(int P_0, Context context)
-    {
-        throw new NotImplementedException("Not Implemented");
-    }
+    public static int fd_datasync(int fd, Context context) => fd_sync(fd, context);
     
     public static int fd_fdstat_set_flags(int P_0, int P_1, Context context)
     {
@@ -429,38 +536,43 @@ public class Wasi
 
     }
 
-     static __wasi_filestat_t fileStatFromString(Context ctx, string str)
+     static __wasi_filestat_t toWasiFileStat(in FileStat stat)
      {
          var x = new __wasi_filestat_t();
-         var info = new FileInfo(str);
-         if (info.Exists == false)
-             return x;
-         x.filetype = __wasi_filetype_t.RegularFile;
-         
-             
-         x.size.count = (ulong)info.Length;
+         x.filetype = stat.FileType;
+         x.size.count = stat.Size;
          x.nlink.count = 1;
-         x.ino.id = (ulong)ctx.InodeForFile(str);
-         x.atim.time = (ulong)info.LastAccessTimeUtc.ToFileTime(); 
-         x.ctim.time = (ulong)info.CreationTimeUtc.ToFileTime(); 
-         x.mtim.time = (ulong)info.LastWriteTimeUtc.ToFileTime();
+         x.ino.id = stat.Inode;
+         x.atim.time = stat.AccessTime;
+         x.ctim.time = stat.ChangeTime;
+         x.mtim.time = stat.ModifyTime;
          return x;
      }
     public static int fd_filestat_get(int fd, int retptr, Context context)
     {
-        var fstr = context.GetFdStream(fd) as FileStream;
-        if (fstr == null) return -1;
-        var x = fileStatFromString(context, fstr.Name);
-        x.size.count = (ulong)fstr.Length;
-        x.nlink.count = 1;
-        Unsafe.As<byte, __wasi_filestat_t>(ref context.Memory[retptr]) = x;
+        var entry = context.LookupFd(fd);
+        if (entry == null) return (int) Error.Badf;
+        var stat = new FileStat();
+        if (entry.Path != null)
+            entry.FileSystem.Stat(entry.Path, out stat);
+        stat.FileType = entry.FileType;
+        if (entry.Stream is {CanSeek: true} str)
+            stat.Size = (ulong)str.Length;
+        var x = toWasiFileStat(stat);
+        context.Ref<__wasi_filestat_t>(retptr) = x;
         return 0;
     }
 
 
-    public static int fd_filestat_set_size(int P_0, long P_1, Context context)
+    public static int fd_filestat_set_size(int fd, long size, Context context)
     {
-        throw new NotImplementedException("Not Implemented");
+        var entry = context.LookupFd(fd);
+        if (entry?.Stream == null)
+            return (int) Error.Badf;
+        if (!entry.HasRights(__wasi_rights_t.FD_FILESTAT_SET_SIZE) || !entry.Stream.CanWrite)
+            return (int) Error.Notcapable;
+        entry.Stream.SetLength(size);
+        return 0;
     }
 
     public static int fd_filestat_set_times(int P_0, long P_1, long P_2, int P_3, Context context)
@@ -471,13 +583,41 @@ public class Wasi
     {
         throw new NotImplementedException("Not Implemented");
     }
-    public static int fd_prestat_get(int P_0, int P_1, Context context)
+    [StructLayout(LayoutKind.Sequential)]
+    struct __wasi_prestat_t
     {
-        throw new NotImplementedException("Not Implemented");
+        /**
+     * Only directories can be preopened, so this is always 0.
+     */
+        public byte tag;
+
+        /**
+     * Length of the directory name, in bytes.
+     */
+        public uint pr_name_len;
     }
-    public static int fd_prestat_dir_name(int P_0, int P_1, int P_2, Context context)
+
+    public static int fd_prestat_get(int fd, int retptr0, Context context)
     {
-        throw new NotImplementedException("Not Implemented");
+        var entry = context.LookupFd(fd);
+        if (entry?.PreopenName == null)
+            return (int) Error.Badf;
+        context.Ref<__wasi_prestat_t>(retptr0) = new __wasi_prestat_t
+        {
+            pr_name_len = (uint) System.Text.Encoding.UTF8.GetByteCount(entry.PreopenName)
+        };
+        return 0;
+    }
+
+    public static int fd_prestat_dir_name(int fd, int path, int pathLen, Context context)
+    {
+        var entry = context.LookupFd(fd);
+        if (entry?.PreopenName == null)
+            return (int) Error.Badf;
+        if (System.Text.Encoding.UTF8.GetByteCount(entry.PreopenName) > pathLen)
+            return (int) Error.Nametoolong;
+        System.Text.Encoding.UTF8.GetBytes(entry.PreopenName, context.Span<byte>(path, pathLen));
+        return 0;
     }
     public static int fd_pwrite(int P_0, int P_1, int P_2, long P_3, int P_4, Context context)
     {
@@ -486,78 +626,180 @@ public class Wasi
 
     public static int fd_read(int fd, int iov, int iov_len, int retPtrs, Context context)
     {
-        var stream = context.GetFdStream(fd);
+        var entry = context.LookupFd(fd);
+        if (entry?.Stream == null)
+            return (int) Error.Badf;
+        if (!entry.HasRights(__wasi_rights_t.FD_READ))
+            return (int) Error.Notcapable;
+        var stream = entry.Stream;
+        // make sure a prompt is visible before blocking on input.
+        if (fd == 0)
+            context.Flush();
         var memory = context.Memory;
         int read = 0;
-        for (int i = 0; i < iov_len; i++)
-        {
-            ciovec_t p = Unsafe.Add(ref Unsafe.As<byte, ciovec_t>(ref memory[iov]), i);
-            var span = memory.AsSpan(p.bufptr, p.size);
-            read += stream.Read(span);
-        }
+        foreach (var p in new GuestSpan<ciovec_t>(iov, iov_len).Get(memory))
+            read += stream.Read(memory.AsSpan(p.bufptr, p.size));
 
-        Unsafe.As<byte, int>(ref memory[retPtrs]) = read;
+        new GuestPtr<int>(retPtrs).Deref(memory) = read;
         return 0;
     }
 
-    public static int fd_readdir(int P_0, int P_1, int P_2, long P_3, int P_4, Context context)
+    [StructLayout(LayoutKind.Sequential)]
+    struct __wasi_dirent_t
     {
-        throw new NotImplementedException("Not Implemented");
+        public ulong d_next;
+        public ulong d_ino;
+        public uint d_namlen;
+        public __wasi_filetype_t d_type;
     }
 
-    public static int fd_renumber(int P_0, int P_1, Context context)
+    static IEnumerable<DirEntry> enumerateWithDots(FdEntry dir)
     {
-        throw new NotImplementedException("Not Implemented");
+        yield return new DirEntry {Name = ".", FileType = __wasi_filetype_t.Directory};
+        yield return new DirEntry {Name = "..", FileType = __wasi_filetype_t.Directory};
+        foreach (var e in dir.FileSystem.EnumerateDirectory(dir.Path!))
+            yield return e;
+    }
+
+    // copies as much of src as fits and returns the number of bytes written.
+    static int writeTruncated(ReadOnlySpan<byte> src, Span<byte> dst)
+    {
+        var n = Math.Min(src.Length, dst.Length);
+        src.Slice(0, n).CopyTo(dst);
+        return n;
+    }
+
+    /// <summary>
+    /// Streams directory entries into the guest buffer. The enumerator is kept on the fd between calls, so
+    /// listing a directory in a loop continues where the previous call stopped instead of rescanning it. An
+    /// entry that is cut off by the end of the buffer is kept and written again by the next call.
+    /// </summary>
+    public static int fd_readdir(int fd, int buf, int bufLen, long cookie, int retptr0, Context context)
+    {
+        var entry = context.LookupFd(fd);
+        if (entry == null) return (int) Error.Badf;
+        if (!entry.IsDirectory || entry.Path == null) return (int) Error.Notdir;
+        if (!entry.HasRights(__wasi_rights_t.READDIR)) return (int) Error.Notcapable;
+
+        if (entry.DirCursor == null || (ulong) cookie != entry.DirCookie)
+        {
+            // first call, rewinddir or seekdir: start over and skip to the cookie.
+            entry.DirCursor?.Dispose();
+            entry.DirCursor = enumerateWithDots(entry).GetEnumerator();
+            entry.DirCookie = 0;
+            entry.DirPending = null;
+            while (entry.DirCookie < (ulong) cookie && entry.DirCursor.MoveNext())
+                entry.DirCookie++;
+        }
+
+        var output = context.Memory.AsSpan(buf, bufLen);
+        Span<byte> header = stackalloc byte[Unsafe.SizeOf<__wasi_dirent_t>()];
+        int used = 0;
+        while (used < output.Length)
+        {
+            DirEntry next;
+            if (entry.DirPending is { } pending)
+                next = pending;
+            else if (entry.DirCursor.MoveNext())
+                next = entry.DirCursor.Current;
+            else
+                break;
+
+            var nameLen = System.Text.Encoding.UTF8.GetByteCount(next.Name);
+            var dirent = new __wasi_dirent_t
+            {
+                d_next = entry.DirCookie + 1, d_ino = next.Inode, d_namlen = (uint) nameLen, d_type = next.FileType
+            };
+            MemoryMarshal.Write(header, ref dirent);
+            used += writeTruncated(header, output.Slice(used));
+            var rest = output.Slice(used);
+            if (rest.Length >= nameLen)
+            {
+                used += System.Text.Encoding.UTF8.GetBytes(next.Name, rest);
+                entry.DirPending = null;
+                entry.DirCookie++;
+                continue;
+            }
+
+            // a full buffer tells the guest to come back with the cookie of the last complete entry.
+            used += writeTruncated(System.Text.Encoding.UTF8.GetBytes(next.Name), rest);
+            entry.DirPending = next;
+        }
+
+        context.Ref<int>(retptr0) = used;
+        return 0;
+    }
+
+    public static int fd_renumber(int fd, int to, Context context)
+    {
+        return context.Fds.Renumber(fd, to) ? 0 : (int) Error.Badf;
     }
 
     public static int fd_seek(int fd, long offset, SeekOrigin whence, int retptr, Context context)
     {
         var fptr = context.GetFdStream(fd);
+        if (fptr == null)
+            return (int) Error.Badf;
+        if (!fptr.CanSeek)
+            return (int) Error.Spipe;
         var o = (ulong)fptr.Seek(offset, whence);
-        var mem = context.Memory;
-        Unsafe.As<byte, ulong>(ref mem[retptr]) = o;
+        context.Ref<ulong>(retptr) = o;
         return 0;
     }
     
     public static int fd_sync(int fd, Context context)
     {
-        var obj = context.LookupFd(fd);
-        if (obj is FileStream fs)
-            fs.Flush();
-        if (obj is DirectoryInfo)
-        {
-            // cannot sync directory.
-            
-        }
+        var entry = context.LookupFd(fd);
+        if (entry == null)
+            return (int) Error.Badf;
+        // directories have no stream and cannot be synced.
+        if (entry.Stream is FileStream fs)
+            fs.Flush(true);
+        else
+            entry.Stream?.Flush();
         return 0;
     }
     public static int fd_tell(int P_0, int P_1, Context context)
     {
         throw new NotImplementedException("Not Implemented");
     }
-    public static int path_create_directory(int P_0, int P_1, int P_2, Context context)
+    public static int path_create_directory(int dirFd, int path, int pathlen, Context context)
     {
-        throw new NotImplementedException("Not Implemented");
+        var pa = context.GetString(path, pathlen);
+        var err = context.ResolvePath(dirFd, pa, out var fullPath, out var dir);
+        if (err != Error.Success)
+            return (int) err;
+        return (int) dir!.FileSystem.CreateDirectory(fullPath);
     }
 
     public enum Error : int
     {
         Success = 0,
-        NoEnt = 44
+        Acces = 2,
+        Badf = 8,
+        Exist = 20,
+        Fault = 21,
+        Inval = 28,
+        Isdir = 31,
+        Nametoolong = 37,
+        NoEnt = 44,
+        Notdir = 54,
+        Notempty = 55,
+        Spipe = 70,
+        Notcapable = 76
     }
     
     public static Error path_filestat_get(int dirFd, LookupFlags flags, int path, int pathlen, int retptr0, Context context)
     {
-        string baseDir = "";
-        if (dirFd == 4)
-        {
-            baseDir = "/tmp/";
-        }
-        var span = context.Memory.AsSpan(path, pathlen);
-        var path2 = System.Text.Encoding.UTF8.GetString(span);
-        var x = fileStatFromString(context, baseDir + path2);
-        Unsafe.As<byte, __wasi_filestat_t>(ref context.Memory[retptr0]) = x;
-        return x.filetype == __wasi_filetype_t.Unknown ? Error.NoEnt : Error.Success;
+        var path2 = context.GetString(path, pathlen);
+        var err = context.ResolvePath(dirFd, path2, out var hostPath, out var dir);
+        if (err != Error.Success)
+            return err;
+        err = dir!.FileSystem.Stat(hostPath, out var stat);
+        if (err != Error.Success)
+            return err;
+        context.Ref<__wasi_filestat_t>(retptr0) = toWasiFileStat(stat);
+        return Error.Success;
     }
     public static int path_filestat_set_times(int P_0, int P_1, int P_2, int P_3, long P_4, long P_5, int P_6, Context context)
     {
@@ -588,36 +830,30 @@ public class Wasi
     }
     public static int path_open(int dirFd, LookupFlags dirFlags, int pathPtr, int pathlen,  OFlags o_flags, __wasi_rights_t fs_rights_base, __wasi_rights_t fs_rights_inheriting, FdFlags fdflags, int retptr0, Context context)
     {
-        string baseDir = "";
-        if (dirFd == 4)
-        {
-            baseDir = "/tmp/";
-        }
-        else
-        {
-            throw new Exception("??");
-        }
-        var pathMem= context.Memory.AsSpan(pathPtr);
-        var end = pathMem.IndexOf((byte)0);
-        var pa = System.Text.Encoding.UTF8.GetString(pathMem.Slice(0, end));
-         
-        {
-            int fd = context.OpenFileOrDir(baseDir + pa);
-            Unsafe.As<byte, int>(ref context.Memory[retptr0]) = fd;
-            
-            return 0;
-        }
+        var pa = context.GetString(pathPtr, pathlen);
+        var err = context.ResolvePath(dirFd, pa, out var hostPath, out var dir);
+        if (err != Error.Success)
+            return (int) err;
 
-        return 1;
+        err = context.OpenFileOrDir(hostPath, dir!, o_flags, fs_rights_base & dir!.RightsInheriting,
+            fs_rights_inheriting & dir.RightsInheriting, fdflags, out var fd);
+        if (err != Error.Success)
+            return (int) err;
+        context.Ref<int>(retptr0) = fd;
+        return 0;
 
     }
     public static int path_readlink(int P_0, int P_1, int P_2, int P_3, int P_4, int P_5, Context context)
     {
         throw new NotImplementedException("Not Implemented");
     }
-    public static int path_remove_directory(int P_0, int P_1, int P_2, Context context)
+    public static int path_remove_directory(int dirFd, int path, int pathlen, Context context)
     {
-        throw new NotImplementedException("Not Implemented");
+        var pa = context.GetString(path, pathlen);
+        var err = context.ResolvePath(dirFd, pa, out var fullPath, out var dir);
+        if (err != Error.Success)
+            return (int) err;
+        return (int) dir!.FileSystem.RemoveDirectory(fullPath);
     }
     public static int path_rename(int P_0, int P_1, int P_2, int P_3, int P_4, int P_5, Context context)
     {
@@ -630,35 +866,27 @@ public class Wasi
     }
     public static int path_unlink_file(int dirFd, int path, int pathlen, Context context)
     {
-        var bytes =context.Memory.AsSpan().Slice(path, pathlen);
-        var pa = System.Text.Encoding.UTF8.GetString(bytes);
-        string baseDir = "";
-        if (dirFd == 4)
-        {
-            baseDir = "/tmp/";
-        }
-        else
-        {
-            throw new Exception("??");
-        }
-
-        var fullPath = Path.Combine(baseDir, pa);
-        File.Delete(fullPath);
-
-        return 0;
+        var pa = context.GetString(path, pathlen);
+        var err = context.ResolvePath(dirFd, pa, out var fullPath, out var dir);
+        if (err != Error.Success)
+            return (int) err;
+        return (int) dir!.FileSystem.Unlink(fullPath);
     }
 
     public static void sqlite3_io_error_trap(Context context)
     {   
         
     }
-    public static int poll_oneoff(int P_0, int P_1, int P_2, int P_3, Context context)
+    public static int poll_oneoff(int inPtr, int outPtr, int count, int retptr0, Context context)
     {
-        throw new NotImplementedException("Not Implemented");
+        var err = context.Poll.PollOneoff(context, inPtr, outPtr, count, out var events);
+        context.Ref<int>(retptr0) = events;
+        return (int) err;
     }
-    public static void proc_exit(int P_0, Context context)
+    public static void proc_exit(int exitCode, Context context)
     {
-        throw new NotImplementedException("Not Implemented");
+        context.Flush();
+        throw new ProcExitException(exitCode);
     }
     
     
@@ -673,9 +901,10 @@ public class Wasi
         return 0;
     }
 
-    public static int random_get(int P_0, int P_1, Context context)
+    public static int random_get(int buf, int bufLen, Context context)
     {
-        throw new NotImplementedException("Not Implemented");
+        context.Random.Fill(context.Memory.AsSpan(buf, bufLen));
+        return 0;
     }
     public static int sock_recv(int P_0, int P_1, int P_2, int P_3, int P_4, int P_5, Context context)
     {
@@ -0,0 +1,158 @@
+namespace Wasm2Il;
+
+/// <summary>
+/// An open WASI file descriptor. Stdio streams, files and directories all live in the same slot type.
+/// </summary>
+public class FdEntry
+{
+    public Wasi.__wasi_filetype_t FileType;
+    public Stream? Stream;
+    public string? Path;
+    public IWasiFileSystem FileSystem = HostFileSystem.Instance;
+    public Wasi.__wasi_rights_t RightsBase = Wasi.__wasi_rights_t.ALL;
+    public Wasi.__wasi_rights_t RightsInheriting = Wasi.__wasi_rights_t.ALL;
+    public Wasi.FdFlags Flags;
+
+    /// <summary>
+    /// Guest-visible name when this fd is a preopened directory.
+    /// </summary>
+    public string? PreopenName;
+
+    /// <summary>
+    /// Root of the preopen this directory was reached through. Paths may not resolve outside of it.
+    /// </summary>
+    public string? Root;
+
+    /// <summary>
+    /// Guest relative path to file system path, for paths resolved against this directory.
+    /// </summary>
+    public Dictionary<string, string>? ResolvedPaths;
+
+    /// <summary>
+    /// fd_readdir position: the enumerator, the cookie of the next entry it yields and an entry that did not fit
+    /// into the guest buffer on the previous call.
+    /// </summary>
+    public IEnumerator<DirEntry>? DirCursor;
+    public ulong DirCookie;
+    public DirEntry? DirPending;
+
+    /// <summary>
+    /// Host descriptor poll_oneoff can wait on, for streams that are not a FileStream.
+    /// </summary>
+    public int HostFd = -1;
+
+    public bool IsDirectory => FileType == Wasi.__wasi_filetype_t.Directory;
+
+    public bool HasRights(Wasi.__wasi_rights_t rights) => (RightsBase & rights) == rights;
+
+    public void Close()
+    {
+        Stream?.Dispose();
+        Stream = null;
+        DirCursor?.Dispose();
+        DirCursor = null;
+    }
+}
+
+/// <summary>
+/// Dense file descriptor table. Slots are array-backed and released fds are recycled through a free list,
+/// so allocation, lookup and close are all O(1).
+/// </summary>
+public class FdTable
+{
+    FdEntry?[] slots = new FdEntry?[16];
+    int[] free = new int[16];
+    int freeCount;
+    // first slot that has never been handed out.
+    int top;
+
+    public int Count { get; private set; }
+
+    public FdEntry? this[int fd] => (uint) fd < (uint) top ? slots[fd] : null;
+
+    public int Allocate(FdEntry entry)
+    {
+        int fd;
+        if (freeCount > 0)
+        {
+            fd = free[--freeCount];
+        }
+        else
+        {
+            fd = top++;
+            if (fd == slots.Length)
+                Array.Resize(ref slots, slots.Length * 2);
+        }
+
+        slots[fd] = entry;
+        Count++;
+        return fd;
+    }
+
+    /// <summary>
+    /// Places an entry at a specific fd, replacing (and closing) whatever was there before.
+    /// </summary>
+    public void Insert(int fd, FdEntry entry)
+    {
+        if (fd < 0) throw new ArgumentOutOfRangeException(nameof(fd));
+        if (fd >= top)
+        {
+            if (fd >= slots.Length)
+                Array.Resize(ref slots, Math.Max(slots.Length * 2, fd + 1));
+            // the skipped slots become available for allocation.
+            for (int i = fd - 1; i >= top; i--)
+                pushFree(i);
+            top = fd + 1;
+        }
+        else if (slots[fd] is { } old)
+        {
+            old.Close();
+            Count--;
+        }
+        else
+        {
+            removeFree(fd);
+        }
+
+        slots[fd] = entry;
+        Count++;
+    }
+
+    public FdEntry? Remove(int fd)
+    {
+        var entry = this[fd];
+        if (entry == null) return null;
+        slots[fd] = null;
+        pushFree(fd);
+        Count--;
+        return entry;
+    }
+
+    /// <summary>
+    /// Moves the entry at 'from' to 'to', closing the previous occupant of 'to'.
+    /// </summary>
+    public bool Renumber(int from, int to)
+    {
+        if (this[from] == null || this[to] == null) return false;
+        if (from == to) return true;
+        var entry = Remove(from)!;
+        Insert(to, entry);
+        return true;
+    }
+
+    void pushFree(int fd)
+    {
+        if (freeCount == free.Length)
+            Array.Resize(ref free, free.Length * 2);
+        free[freeCount++] = fd;
+    }
+
+    // only needed when a specific fd is claimed, which is rare (stdio setup and fd_renumber).
+    void removeFree(int fd)
+    {
+        if (freeCount == 0) return;
+        int idx = Array.LastIndexOf(free, fd, freeCount - 1, freeCount);
+        if (idx < 0) return;
+        free[idx] = free[--freeCount];
+    }
+}
@@ -0,0 +1,187 @@
+using System.IO.Enumeration;
+
+namespace Wasm2Il;
+
+public struct DirEntry
+{
+    public string Name;
+    public Wasi.__wasi_filetype_t FileType;
+    public ulong Inode;
+}
+
+public struct FileStat
+{
+    public Wasi.__wasi_filetype_t FileType;
+    public ulong Inode;
+    public ulong Size;
+    // timestamps are nanoseconds since the unix epoch.
+    public ulong AccessTime;
+    public ulong ModifyTime;
+    public ulong ChangeTime;
+}
+
+/// <summary>
+/// Storage behind the WASI path_* and fd_* functions. Paths handed to a file system are absolute paths
+/// produced by its own Combine method.
+/// </summary>
+public interface IWasiFileSystem
+{
+    string Combine(string directory, string relative);
+    Wasi.__wasi_filetype_t GetFileType(string path);
+    Wasi.Error Stat(string path, out FileStat stat);
+    Wasi.Error Open(string path, Wasi.OFlags oflags, FileAccess access, out Stream? stream);
+    Wasi.Error Unlink(string path);
+    Wasi.Error CreateDirectory(string path);
+    Wasi.Error RemoveDirectory(string path);
+
+    /// <summary>
+    /// Lists a directory lazily, without '.' and '..'.
+    /// </summary>
+    IEnumerable<DirEntry> EnumerateDirectory(string path);
+}
+
+/// <summary>
+/// Passes everything through to the host file system.
+/// </summary>
+public class HostFileSystem : IWasiFileSystem
+{
+    public static readonly HostFileSystem Instance = new HostFileSystem();
+
+    private Dictionary<string, ulong> inodes = new Dictionary<string, ulong>();
+    private ulong inodesCounter = 5;
+
+    ulong inodeForFile(string fileName)
+    {
+        lock (inodes)
+        {
+            if (inodes.TryGetValue(fileName, out var inode))
+                return inode;
+            return inodes[fileName] = inodesCounter++;
+        }
+    }
+
+    static ulong toTimestamp(DateTime utc) => (ulong) (utc - DateTime.UnixEpoch).Ticks * 100;
+
+    public string Combine(string directory, string relative) => Path.GetFullPath(Path.Combine(directory, relative));
+
+    public Wasi.__wasi_filetype_t GetFileType(string path)
+    {
+        if (File.Exists(path)) return Wasi.__wasi_filetype_t.RegularFile;
+        if (Directory.Exists(path)) return Wasi.__wasi_filetype_t.Directory;
+        return Wasi.__wasi_filetype_t.Unknown;
+    }
+
+    public Wasi.Error Stat(string path, out FileStat stat)
+    {
+        stat = default;
+        FileSystemInfo info = new FileInfo(path);
+        if (info.Exists)
+        {
+            stat.FileType = Wasi.__wasi_filetype_t.RegularFile;
+            stat.Size = (ulong) ((FileInfo) info).Length;
+        }
+        else
+        {
+            info = new DirectoryInfo(path);
+            if (!info.Exists)
+                return Wasi.Error.NoEnt;
+            stat.FileType = Wasi.__wasi_filetype_t.Directory;
+        }
+
+        stat.Inode = inodeForFile(path);
+        stat.AccessTime = toTimestamp(info.LastAccessTimeUtc);
+        stat.ModifyTime = toTimestamp(info.LastWriteTimeUtc);
+        stat.ChangeTime = toTimestamp(info.CreationTimeUtc);
+        return Wasi.Error.Success;
+    }
+
+    public Wasi.Error Open(string path, Wasi.OFlags oflags, FileAccess access, out Stream? stream)
+    {
+        stream = null;
+        var mode = (oflags & (Wasi.OFlags.CREAT | Wasi.OFlags.EXCL | Wasi.OFlags.TRUNC)) switch
+        {
+            Wasi.OFlags.CREAT | Wasi.OFlags.EXCL or Wasi.OFlags.CREAT | Wasi.OFlags.EXCL | Wasi.OFlags.TRUNC =>
+                FileMode.CreateNew,
+            Wasi.OFlags.CREAT | Wasi.OFlags.TRUNC => FileMode.Create,
+            Wasi.OFlags.CREAT => FileMode.OpenOrCreate,
+            Wasi.OFlags.TRUNC => FileMode.Truncate,
+            _ => FileMode.Open
+        };
+        try
+        {
+            var openMode = mode;
+            if (access == FileAccess.Read && mode is FileMode.CreateNew or FileMode.Create or FileMode.Truncate)
+            {
+                // FileStream refuses to create or truncate through a read-only stream, while POSIX allows
+                // O_RDONLY with O_CREAT and O_TRUNC. The file is prepared through a short-lived writer instead.
+                new FileStream(path, mode, FileAccess.Write, FileShare.ReadWrite | FileShare.Delete).Dispose();
+                openMode = FileMode.Open;
+            }
+
+            stream = new FileStream(path, openMode, access, FileShare.ReadWrite | FileShare.Delete);
+            return Wasi.Error.Success;
+        }
+        catch (FileNotFoundException)
+        {
+            return Wasi.Error.NoEnt;
+        }
+        catch (DirectoryNotFoundException)
+        {
+            return Wasi.Error.NoEnt;
+        }
+        catch (UnauthorizedAccessException)
+        {
+            return Wasi.Error.Acces;
+        }
+        catch (IOException) when (mode == FileMode.CreateNew && File.Exists(path))
+        {
+            return Wasi.Error.Exist;
+        }
+    }
+
+    public Wasi.Error Unlink(string path)
+    {
+        if (Directory.Exists(path))
+            return Wasi.Error.Isdir;
+        if (!File.Exists(path))
+            return Wasi.Error.NoEnt;
+        File.Delete(path);
+        return Wasi.Error.Success;
+    }
+
+    public Wasi.Error CreateDirectory(string path)
+    {
+        if (File.Exists(path) || Directory.Exists(path))
+            return Wasi.Error.Exist;
+        Directory.CreateDirectory(path);
+        return Wasi.Error.Success;
+    }
+
+    public Wasi.Error RemoveDirectory(string path)
+    {
+        if (!Directory.Exists(path))
+            return File.Exists(path) ? Wasi.Error.Notdir : Wasi.Error.NoEnt;
+        if (Directory.EnumerateFileSystemEntries(path).Any())
+            return Wasi.Error.Notempty;
+        Directory.Delete(path);
+        return Wasi.Error.Success;
+    }
+
+    static readonly EnumerationOptions enumerationOptions = new EnumerationOptions
+    {
+        RecurseSubdirectories = false, IgnoreInaccessible = true, AttributesToSkip = 0
+    };
+
+    public IEnumerable<DirEntry> EnumerateDirectory(string path)
+    {
+        return new FileSystemEnumerable<DirEntry>(path, (ref FileSystemEntry entry) => new DirEntry
+        {
+            Name = entry.FileName.ToString(),
+            FileType = entry.IsDirectory
+                ? Wasi.__wasi_filetype_t.Directory
+                : (entry.Attributes & FileAttributes.ReparsePoint) != 0
+                    ? Wasi.__wasi_filetype_t.SymbolicLink
+                    : Wasi.__wasi_filetype_t.RegularFile
+        }, enumerationOptions);
+    }
+}
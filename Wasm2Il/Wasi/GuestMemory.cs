@@ -0,0 +1,91 @@
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace Wasm2Il;
+
+/// <summary>
+/// A typed pointer into guest memory. Dereferencing checks that the whole value is inside the memory.
+/// </summary>
+public readonly struct GuestPtr<T> where T : unmanaged
+{
+    public readonly int Address;
+
+    public GuestPtr(int address)
+    {
+        Address = address;
+    }
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public ref T Deref(byte[] memory) =>
+        ref MemoryMarshal.AsRef<T>(memory.AsSpan(Address, Unsafe.SizeOf<T>()));
+
+    public GuestPtr<T> this[int index] => new GuestPtr<T>(Address + index * Unsafe.SizeOf<T>());
+
+    public static implicit operator GuestPtr<T>(int address) => new GuestPtr<T>(address);
+}
+
+/// <summary>
+/// A typed array in guest memory, such as an iovec list. Get checks the bounds once and returns a span over
+/// the memory itself, so nothing is copied.
+/// </summary>
+public readonly struct GuestSpan<T> where T : unmanaged
+{
+    public readonly int Address;
+    public readonly int Length;
+
+    public GuestSpan(int address, int length)
+    {
+        Address = address;
+        Length = length;
+    }
+
+    [MethodImpl(MethodImplOptions.AggressiveInlining)]
+    public Span<T> Get(byte[] memory)
+    {
+        if (Length < 0)
+            throw new ArgumentOutOfRangeException(nameof(Length));
+        return MemoryMarshal.Cast<byte, T>(memory.AsSpan(Address, checked(Length * Unsafe.SizeOf<T>())));
+    }
+}
+
+/// <summary>
+/// Decodes UTF-8 strings from guest memory, returning the same string instance when the same bytes are decoded
+/// again. Guests pass the same paths over and over, so repeated calls do not allocate.
+/// </summary>
+public class Utf8StringCache
+{
+    struct Entry
+    {
+        public int Hash;
+        public byte[]? Bytes;
+        public string Value;
+    }
+
+    // direct mapped; a collision simply replaces the older entry.
+    readonly Entry[] entries;
+    readonly int maxLength;
+
+    public Utf8StringCache(int size = 256, int maxLength = 512)
+    {
+        entries = new Entry[size];
+        this.maxLength = maxLength;
+    }
+
+    public string Get(ReadOnlySpan<byte> bytes)
+    {
+        if (bytes.Length == 0)
+            return "";
+        if (bytes.Length > maxLength)
+            return System.Text.Encoding.UTF8.GetString(bytes);
+        var hc = new HashCode();
+        hc.AddBytes(bytes);
+        var hash = hc.ToHashCode();
+        ref var entry = ref entries[(uint) hash % (uint) entries.Length];
+        if (entry.Hash == hash && entry.Bytes != null && bytes.SequenceEqual(entry.Bytes))
+            return entry.Value;
+        entry.Hash = hash;
+        entry.Bytes = bytes.ToArray();
+        entry.Value = System.Text.Encoding.UTF8.GetString(bytes);
+        return entry.Value;
+    }
+}
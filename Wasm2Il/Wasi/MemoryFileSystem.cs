@@ -0,0 +1,310 @@
+namespace Wasm2Il;
+
+/// <summary>
+/// A file system that lives entirely in managed memory. File contents are stored in fixed size pages,
+/// so growing a file never copies existing data and no system calls are made.
+/// </summary>
+public class MemoryFileSystem : IWasiFileSystem
+{
+    public const int PageSize = 16 * 1024;
+
+    public class Node
+    {
+        public ulong Inode;
+        public Dictionary<string, Node>? Children;
+        public List<byte[]> Pages = new List<byte[]>();
+        public long Length;
+        public ulong AccessTime, ModifyTime, ChangeTime;
+
+        public bool IsDirectory => Children != null;
+
+        public void SetLength(long length)
+        {
+            var pageCount = (int) ((length + PageSize - 1) / PageSize);
+            if (pageCount < Pages.Count)
+                Pages.RemoveRange(pageCount, Pages.Count - pageCount);
+            if (length < Length && pageCount > 0)
+            {
+                // clear the tail of the last page, so growing the file again reads zeros.
+                var tail = (int) (length % PageSize);
+                if (tail != 0)
+                    Pages[pageCount - 1].AsSpan(tail).Clear();
+            }
+
+            Length = length;
+        }
+
+        public int Read(long position, Span<byte> buffer)
+        {
+            if (position >= Length) return 0;
+            var count = (int) Math.Min(buffer.Length, Length - position);
+            var done = 0;
+            while (done < count)
+            {
+                var page = (int) (position / PageSize);
+                var offset = (int) (position % PageSize);
+                var n = Math.Min(count - done, PageSize - offset);
+                if (page < Pages.Count)
+                    Pages[page].AsSpan(offset, n).CopyTo(buffer.Slice(done, n));
+                else
+                    buffer.Slice(done, n).Clear();
+                done += n;
+                position += n;
+            }
+
+            return count;
+        }
+
+        public void Write(long position, ReadOnlySpan<byte> buffer)
+        {
+            var end = position + buffer.Length;
+            var pageCount = (int) ((end + PageSize - 1) / PageSize);
+            while (Pages.Count < pageCount)
+                Pages.Add(new byte[PageSize]);
+            while (buffer.Length > 0)
+            {
+                var page = (int) (position / PageSize);
+                var offset = (int) (position % PageSize);
+                var n = Math.Min(buffer.Length, PageSize - offset);
+                buffer.Slice(0, n).CopyTo(Pages[page].AsSpan(offset, n));
+                buffer = buffer.Slice(n);
+                position += n;
+            }
+
+            if (end > Length)
+                Length = end;
+        }
+    }
+
+    class NodeStream : Stream
+    {
+        readonly Node node;
+        readonly FileAccess access;
+        long position;
+
+        public NodeStream(Node node, FileAccess access)
+        {
+            this.node = node;
+            this.access = access;
+        }
+
+        public override bool CanRead => (access & FileAccess.Read) != 0;
+        public override bool CanSeek => true;
+        public override bool CanWrite => (access & FileAccess.Write) != 0;
+        public override long Length => node.Length;
+
+        public override long Position
+        {
+            get => position;
+            set => position = value;
+        }
+
+        public override void Flush()
+        {
+        }
+
+        public override int Read(byte[] buffer, int offset, int count) => Read(buffer.AsSpan(offset, count));
+
+        public override int Read(Span<byte> buffer)
+        {
+            var n = node.Read(position, buffer);
+            position += n;
+            node.AccessTime = now();
+            return n;
+        }
+
+        public override void Write(byte[] buffer, int offset, int count) =>
+            Write(new ReadOnlySpan<byte>(buffer, offset, count));
+
+        public override void Write(ReadOnlySpan<byte> buffer)
+        {
+            if (!CanWrite) throw new NotSupportedException();
+            node.Write(position, buffer);
+            position += buffer.Length;
+            node.ModifyTime = now();
+        }
+
+        public override long Seek(long offset, SeekOrigin origin)
+        {
+            var p = origin switch
+            {
+                SeekOrigin.Begin => offset,
+                SeekOrigin.Current => position + offset,
+                _ => node.Length + offset
+            };
+            if (p < 0) throw new IOException("Seek before start of file");
+            return position = p;
+        }
+
+        public override void SetLength(long value)
+        {
+            if (!CanWrite) throw new NotSupportedException();
+            node.SetLength(value);
+            node.ModifyTime = now();
+        }
+    }
+
+    readonly Node root;
+    ulong inodeCounter = 1;
+
+    public MemoryFileSystem()
+    {
+        root = newNode(true);
+    }
+
+    static ulong now() => (ulong) (DateTime.UtcNow - DateTime.UnixEpoch).Ticks * 100;
+
+    Node newNode(bool directory)
+    {
+        var t = now();
+        return new Node
+        {
+            Inode = inodeCounter++, Children = directory ? new Dictionary<string, Node>() : null,
+            AccessTime = t, ModifyTime = t, ChangeTime = t
+        };
+    }
+
+    public string Combine(string directory, string relative)
+    {
+        var parts = new List<string>();
+        foreach (var p in (relative.StartsWith('/') ? relative : directory + "/" + relative).Split('/'))
+        {
+            if (p.Length == 0 || p == ".") continue;
+            if (p == "..")
+            {
+                // '..' at the root is left in, so the caller's sandbox check rejects it.
+                if (parts.Count > 0 && parts[^1] != "..") parts.RemoveAt(parts.Count - 1);
+                else parts.Add(p);
+            }
+            else parts.Add(p);
+        }
+
+        return "/" + string.Join('/', parts);
+    }
+
+    Node? find(string path)
+    {
+        var node = root;
+        foreach (var p in path.Split('/', StringSplitOptions.RemoveEmptyEntries))
+        {
+            if (node.Children == null || !node.Children.TryGetValue(p, out node))
+                return null;
+        }
+
+        return node;
+    }
+
+    Node? findParent(string path, out string name)
+    {
+        var idx = path.LastIndexOf('/');
+        name = path.Substring(idx + 1);
+        var parent = find(path.Substring(0, idx));
+        return parent?.IsDirectory == true && name.Length > 0 ? parent : null;
+    }
+
+    public Wasi.__wasi_filetype_t GetFileType(string path)
+    {
+        var node = find(path);
+        if (node == null) return Wasi.__wasi_filetype_t.Unknown;
+        return node.IsDirectory ? Wasi.__wasi_filetype_t.Directory : Wasi.__wasi_filetype_t.RegularFile;
+    }
+
+    public Wasi.Error Stat(string path, out FileStat stat)
+    {
+        stat = default;
+        var node = find(path);
+        if (node == null)
+            return Wasi.Error.NoEnt;
+        stat.FileType = node.IsDirectory ? Wasi.__wasi_filetype_t.Directory : Wasi.__wasi_filetype_t.RegularFile;
+        stat.Inode = node.Inode;
+        stat.Size = (ulong) node.Length;
+        stat.AccessTime = node.AccessTime;
+        stat.ModifyTime = node.ModifyTime;
+        stat.ChangeTime = node.ChangeTime;
+        return Wasi.Error.Success;
+    }
+
+    public Wasi.Error Open(string path, Wasi.OFlags oflags, FileAccess access, out Stream? stream)
+    {
+        stream = null;
+        var node = find(path);
+        if (node == null)
+        {
+            if ((oflags & Wasi.OFlags.CREAT) == 0)
+                return Wasi.Error.NoEnt;
+            var parent = findParent(path, out var name);
+            if (parent == null)
+                return Wasi.Error.NoEnt;
+            parent.Children![name] = node = newNode(false);
+        }
+        else if ((oflags & (Wasi.OFlags.CREAT | Wasi.OFlags.EXCL)) == (Wasi.OFlags.CREAT | Wasi.OFlags.EXCL))
+        {
+            return Wasi.Error.Exist;
+        }
+        else if (node.IsDirectory)
+        {
+            return Wasi.Error.Isdir;
+        }
+        else if ((oflags & Wasi.OFlags.TRUNC) != 0)
+        {
+            node.SetLength(0);
+        }
+
+        stream = new NodeStream(node, access);
+        return Wasi.Error.Success;
+    }
+
+    public Wasi.Error Unlink(string path)
+    {
+        var parent = findParent(path, out var name);
+        if (parent == null || !parent.Children!.TryGetValue(name, out var node))
+            return Wasi.Error.NoEnt;
+        if (node.IsDirectory)
+            return Wasi.Error.Isdir;
+        // open streams keep the node alive, like an unlinked file on posix.
+        parent.Children.Remove(name);
+        return Wasi.Error.Success;
+    }
+
+    public Wasi.Error CreateDirectory(string path)
+    {
+        var parent = findParent(path, out var name);
+        if (parent == null)
+            return Wasi.Error.NoEnt;
+        if (parent.Children!.ContainsKey(name))
+            return Wasi.Error.Exist;
+        parent.Children[name] = newNode(true);
+        return Wasi.Error.Success;
+    }
+
+    public Wasi.Error RemoveDirectory(string path)
+    {
+        var parent = findParent(path, out var name);
+        if (parent == null || !parent.Children!.TryGetValue(name, out var node))
+            return Wasi.Error.NoEnt;
+        if (!node.IsDirectory)
+            return Wasi.Error.Notdir;
+        if (node.Children!.Count > 0)
+            return Wasi.Error.Notempty;
+        parent.Children.Remove(name);
+        return Wasi.Error.Success;
+    }
+
+    public IEnumerable<DirEntry> EnumerateDirectory(string path)
+    {
+        var node = find(path);
+        if (node?.Children == null)
+            yield break;
+        // snapshot, so the guest can modify the directory while listing it.
+        foreach (var child in node.Children.ToArray())
+        {
+            yield return new DirEntry
+            {
+                Name = child.Key, Inode = child.Value.Inode,
+                FileType = child.Value.IsDirectory
+                    ? Wasi.__wasi_filetype_t.Directory
+                    : Wasi.__wasi_filetype_t.RegularFile
+            };
+        }
+    }
+}
@@ -0,0 +1,178 @@
+using System.Diagnostics;
+using System.Runtime.InteropServices;
+
+namespace Wasm2Il;
+
+/// <summary>
+/// Clock sources for clock_time_get and clock_res_get. All times are in nanoseconds and no call allocates.
+/// </summary>
+public static class WasiClock
+{
+    public const int Realtime = 0;
+    public const int Monotonic = 1;
+    public const int ProcessCpuTime = 2;
+    public const int ThreadCpuTime = 3;
+
+    static readonly long frequency = Stopwatch.Frequency;
+    static readonly long epochTicks = DateTime.UnixEpoch.Ticks;
+
+    static long nanoseconds(long timestamp)
+    {
+        if (frequency == 1_000_000_000)
+            return timestamp;
+        // split to avoid overflowing while keeping full precision.
+        long seconds = timestamp / frequency;
+        long rest = timestamp % frequency;
+        return seconds * 1_000_000_000 + rest * 1_000_000_000 / frequency;
+    }
+
+    public static ulong RealtimeNow() => (ulong) (DateTime.UtcNow.Ticks - epochTicks) * 100;
+
+    public static ulong MonotonicNow() => (ulong) nanoseconds(Stopwatch.GetTimestamp());
+
+    static readonly object coarseLock = new object();
+    static Timer? coarseTimer;
+    static long coarseResolution;
+    static long coarseRealtime;
+    static long coarseMonotonic;
+    static long lastMonotonic;
+
+    /// <summary>
+    /// Starts a timer that caches the realtime and monotonic clocks. Guests asking for a precision of at least
+    /// the interval are served the cached value without reading the clock.
+    /// </summary>
+    public static void EnableCoarseClock(TimeSpan interval)
+    {
+        lock (coarseLock)
+        {
+            coarseTimer?.Dispose();
+            updateCoarse(null);
+            Volatile.Write(ref coarseResolution, interval.Ticks * 100);
+            coarseTimer = new Timer(updateCoarse, null, interval, interval);
+        }
+    }
+
+    public static void DisableCoarseClock()
+    {
+        lock (coarseLock)
+        {
+            Volatile.Write(ref coarseResolution, 0);
+            coarseTimer?.Dispose();
+            coarseTimer = null;
+        }
+    }
+
+    static void updateCoarse(object? state)
+    {
+        Volatile.Write(ref coarseRealtime, (long) RealtimeNow());
+        Volatile.Write(ref coarseMonotonic, (long) MonotonicNow());
+    }
+
+    // once coarse values are handed out, a precise read must never make a later coarse read go backwards.
+    static ulong monotonic(bool coarse)
+    {
+        if (coarse)
+            return (ulong) Math.Max(Volatile.Read(ref coarseMonotonic), Volatile.Read(ref lastMonotonic));
+        var now = (long) MonotonicNow();
+        if (Volatile.Read(ref coarseResolution) != 0)
+        {
+            long last;
+            while ((last = Volatile.Read(ref lastMonotonic)) < now &&
+                   Interlocked.CompareExchange(ref lastMonotonic, now, last) != last)
+            {
+            }
+        }
+
+        return (ulong) now;
+    }
+
+    public static Wasi.Error GetTime(int clockId, ulong precision, out ulong time)
+    {
+        var coarseRes = Volatile.Read(ref coarseResolution);
+        bool coarse = coarseRes != 0 && precision >= (ulong) coarseRes;
+        switch (clockId)
+        {
+            case Realtime:
+                time = coarse ? (ulong) Volatile.Read(ref coarseRealtime) : RealtimeNow();
+                return Wasi.Error.Success;
+            case Monotonic:
+                time = monotonic(coarse);
+                return Wasi.Error.Success;
+            case ProcessCpuTime:
+            case ThreadCpuTime:
+                return cpuTime(clockId == ThreadCpuTime, out time);
+            default:
+                time = 0;
+                return Wasi.Error.Inval;
+        }
+    }
+
+    public static Wasi.Error GetResolution(int clockId, out ulong resolution)
+    {
+        switch (clockId)
+        {
+            case Realtime:
+                resolution = 100;
+                return Wasi.Error.Success;
+            case Monotonic:
+                resolution = (ulong) Math.Max(1, 1_000_000_000 / frequency);
+                return Wasi.Error.Success;
+            case ProcessCpuTime:
+            case ThreadCpuTime:
+                if (!OperatingSystem.IsWindows() && clock_getres(cpuClockId(clockId == ThreadCpuTime), out var ts) == 0)
+                    resolution = (ulong) (ts.tv_sec * 1_000_000_000 + ts.tv_nsec);
+                else
+                    resolution = 100;
+                return Wasi.Error.Success;
+            default:
+                resolution = 0;
+                return Wasi.Error.Inval;
+        }
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    struct timespec
+    {
+        public nint tv_sec;
+        public nint tv_nsec;
+    }
+
+    [DllImport("libc", SetLastError = false)]
+    static extern int clock_gettime(int clockId, out timespec tp);
+
+    [DllImport("libc", SetLastError = false)]
+    static extern int clock_getres(int clockId, out timespec tp);
+
+    [DllImport("kernel32")]
+    static extern bool GetProcessTimes(nint process, out long creation, out long exit, out long kernel, out long user);
+
+    [DllImport("kernel32")]
+    static extern bool GetThreadTimes(nint thread, out long creation, out long exit, out long kernel, out long user);
+
+    static int cpuClockId(bool thread)
+    {
+        if (OperatingSystem.IsMacOS())
+            return thread ? 16 : 12;
+        return thread ? 3 : 2;
+    }
+
+    static Wasi.Error cpuTime(bool thread, out ulong time)
+    {
+        time = 0;
+        if (OperatingSystem.IsWindows())
+        {
+            // pseudo handles for the current process and thread.
+            bool ok = thread
+                ? GetThreadTimes(-2, out _, out _, out var kernel, out var user)
+                : GetProcessTimes(-1, out _, out _, out kernel, out user);
+            if (!ok) return Wasi.Error.Inval;
+            time = (ulong) (kernel + user) * 100;
+            return Wasi.Error.Success;
+        }
+
+        if (clock_gettime(cpuClockId(thread), out var ts) != 0)
+            return Wasi.Error.Inval;
+        time = (ulong) (ts.tv_sec * 1_000_000_000 + ts.tv_nsec);
+        return Wasi.Error.Success;
+    }
+}
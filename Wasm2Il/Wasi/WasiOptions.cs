@@ -0,0 +1,67 @@
+namespace Wasm2Il;
+
+/// <summary>
+/// A directory exposed to the guest as a preopened directory fd. HostPath is interpreted by FileSystem,
+/// which defaults to the host file system.
+/// </summary>
+public record Preopen(string GuestPath, string HostPath, IWasiFileSystem? FileSystem = null);
+
+/// <summary>
+/// Settings used when a module's WASI context is created. Set these before calling into a compiled module.
+/// </summary>
+public class WasiOptions
+{
+    public List<Preopen> Preopens = new List<Preopen>();
+
+    /// <summary>
+    /// When set, clock_time_get serves realtime and monotonic reads from a cache refreshed at this interval,
+    /// for any call whose requested precision is at least the interval.
+    /// </summary>
+    public TimeSpan? CoarseClockInterval;
+
+    /// <summary>
+    /// Makes random_get return a reproducible sequence. Only meant for benchmarks and tests.
+    /// </summary>
+    public int? RandomSeed;
+
+    /// <summary>
+    /// Replacements for the console streams, e.g. a MemoryStream to capture guest output.
+    /// </summary>
+    public Stream? Stdin, Stdout, Stderr;
+
+    /// <summary>
+    /// Size of the stdout and stderr write buffers. They are flushed on fd_sync, proc_exit and host shutdown.
+    /// </summary>
+    public int OutputBufferSize = 64 * 1024;
+
+    /// <summary>
+    /// Preopens used when none have been configured: only /tmp, as fd 3. The working directory is not exposed
+    /// unless asked for with --dir.
+    /// </summary>
+    public IEnumerable<Preopen> GetPreopens()
+    {
+        if (Preopens.Count > 0)
+            return Preopens;
+        return new[] {new Preopen("/tmp", Path.GetTempPath())};
+    }
+
+    /// <summary>
+    /// Parses a '--dir' argument, either 'guest=host' or a single path used for both.
+    /// </summary>
+    public void AddPreopen(string arg)
+    {
+        var idx = arg.IndexOf('=');
+        if (idx < 0)
+            Preopens.Add(new Preopen(arg, arg));
+        else
+            Preopens.Add(new Preopen(arg.Substring(0, idx), arg.Substring(idx + 1)));
+    }
+
+    /// <summary>
+    /// Parses a '--memdir' argument: a guest path backed by a new, empty in-memory file system.
+    /// </summary>
+    public void AddMemoryPreopen(string guestPath)
+    {
+        Preopens.Add(new Preopen(guestPath, "/", new MemoryFileSystem()));
+    }
+}
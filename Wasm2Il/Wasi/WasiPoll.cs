@@ -0,0 +1,295 @@
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace Wasm2Il;
+
+/// <summary>
+/// Backs poll_oneoff. Clock subscriptions are turned into a single deadline and fd subscriptions into an epoll
+/// wait on Linux, so a guest that sleeps or waits for input blocks in the kernel instead of spinning.
+/// </summary>
+public class WasiPoll : IDisposable
+{
+    public const byte EventClock = 0;
+    public const byte EventFdRead = 1;
+    public const byte EventFdWrite = 2;
+    const ushort SubclockAbstime = 1;
+
+    [StructLayout(LayoutKind.Explicit, Size = 48)]
+    struct __wasi_subscription_t
+    {
+        [FieldOffset(0)] public ulong userdata;
+        [FieldOffset(8)] public byte tag;
+        [FieldOffset(16)] public int clock_id;
+        [FieldOffset(16)] public int fd;
+        [FieldOffset(24)] public ulong timeout;
+        [FieldOffset(32)] public ulong precision;
+        [FieldOffset(40)] public ushort flags;
+    }
+
+    [StructLayout(LayoutKind.Explicit, Size = 32)]
+    struct __wasi_event_t
+    {
+        [FieldOffset(0)] public ulong userdata;
+        [FieldOffset(8)] public ushort error;
+        [FieldOffset(10)] public byte type;
+        [FieldOffset(16)] public ulong nbytes;
+        [FieldOffset(24)] public ushort flags;
+    }
+
+    int epollFd = -1;
+    // host fds currently registered with epoll; kept between calls so a guest polling the same fds in a loop
+    // does not pay for re-registering them every time.
+    readonly HashSet<int> registered = new HashSet<int>();
+    readonly HashSet<int> waitFds = new HashSet<int>();
+    readonly HashSet<int> readyFds = new HashSet<int>();
+
+    public Wasi.Error PollOneoff(Wasi.Context context, int inPtr, int outPtr, int count, out int eventCount)
+    {
+        eventCount = 0;
+        if (count <= 0)
+            return Wasi.Error.Inval;
+        if (count > int.MaxValue / Unsafe.SizeOf<__wasi_subscription_t>())
+            return Wasi.Error.Inval;
+        var memory = context.Memory;
+        // both arrays are checked before anything is read or written, so a bad pointer is reported to the
+        // guest instead of failing half way through.
+        if (!inMemory(memory, inPtr, count * Unsafe.SizeOf<__wasi_subscription_t>())
+            || !inMemory(memory, outPtr, count * Unsafe.SizeOf<__wasi_event_t>()))
+            return Wasi.Error.Fault;
+        var subs = new GuestSpan<__wasi_subscription_t>(inPtr, count).Get(memory);
+        var events = new GuestSpan<__wasi_event_t>(outPtr, count).Get(memory);
+
+        // subscriptions that are not ready yet. For clocks the value is the monotonic deadline,
+        // for fds the host descriptor.
+        Span<int> pending = count <= 64 ? stackalloc int[count] : new int[count];
+        Span<ulong> pendingValue = count <= 64 ? stackalloc ulong[count] : new ulong[count];
+        int pendingCount = 0;
+        ulong deadline = ulong.MaxValue;
+        var start = WasiClock.MonotonicNow();
+        waitFds.Clear();
+
+        for (int i = 0; i < count; i++)
+        {
+            var sub = subs[i];
+            if (sub.tag == EventClock)
+            {
+                if (!clockDeadline(sub, start, out var d))
+                {
+                    writeEvent(events, ref eventCount, sub.userdata, Wasi.Error.Inval, EventClock, 0);
+                    continue;
+                }
+
+                deadline = Math.Min(deadline, d);
+                pending[pendingCount] = i;
+                pendingValue[pendingCount++] = d;
+                continue;
+            }
+
+            if (sub.tag != EventFdRead && sub.tag != EventFdWrite)
+            {
+                writeEvent(events, ref eventCount, sub.userdata, Wasi.Error.Inval, sub.tag, 0);
+                continue;
+            }
+
+            var entry = context.LookupFd(sub.fd);
+            if (entry?.Stream == null)
+            {
+                writeEvent(events, ref eventCount, sub.userdata, Wasi.Error.Badf, sub.tag, 0);
+                continue;
+            }
+
+            var hostFd = sub.tag == EventFdRead ? hostDescriptor(entry) : -1;
+            if (hostFd < 0 || !register(hostFd))
+            {
+                // files, memory streams and output never block, so they are reported ready right away.
+                ulong available = 0;
+                if (sub.tag == EventFdRead && entry.Stream.CanSeek)
+                    available = (ulong) Math.Max(0, entry.Stream.Length - entry.Stream.Position);
+                writeEvent(events, ref eventCount, sub.userdata, Wasi.Error.Success, sub.tag, available);
+                continue;
+            }
+
+            waitFds.Add(hostFd);
+            pending[pendingCount] = i;
+            pendingValue[pendingCount++] = (ulong) hostFd;
+        }
+
+        unregisterUnused();
+        // only block when nothing is ready yet.
+        var wait = eventCount == 0 && pendingCount > 0;
+        if (waitFds.Count > 0)
+            waitEpoll(wait ? deadline : 0);
+        else if (wait)
+            sleepUntil(deadline);
+
+        var now = WasiClock.MonotonicNow();
+        for (int j = 0; j < pendingCount; j++)
+        {
+            var sub = subs[pending[j]];
+            if (sub.tag == EventClock)
+            {
+                if (pendingValue[j] <= now)
+                    writeEvent(events, ref eventCount, sub.userdata, Wasi.Error.Success, EventClock, 0);
+            }
+            else if (readyFds.Contains((int) pendingValue[j]))
+            {
+                writeEvent(events, ref eventCount, sub.userdata, Wasi.Error.Success, sub.tag, 1);
+            }
+        }
+
+        return Wasi.Error.Success;
+    }
+
+    // relative timeouts count from the start of the call, absolute ones are converted from their clock to
+    // the monotonic clock.
+    static bool clockDeadline(in __wasi_subscription_t sub, ulong start, out ulong deadline)
+    {
+        deadline = 0;
+        if (WasiClock.GetTime(sub.clock_id, 0, out var clockNow) != Wasi.Error.Success)
+            return false;
+        var timeout = sub.timeout;
+        if ((sub.flags & SubclockAbstime) != 0)
+            timeout = timeout <= clockNow ? 0 : timeout - clockNow;
+        deadline = start + timeout < start ? ulong.MaxValue : start + timeout;
+        return true;
+    }
+
+    static bool inMemory(byte[] memory, int ptr, int length) =>
+        (ulong) (uint) ptr + (uint) length <= (ulong) memory.Length;
+
+    static void writeEvent(Span<__wasi_event_t> events, ref int eventCount, ulong userdata, Wasi.Error error,
+        byte type, ulong nbytes)
+    {
+        events[eventCount] = new __wasi_event_t
+        {
+            userdata = userdata, error = (ushort) error, type = type, nbytes = nbytes
+        };
+        eventCount++;
+    }
+
+    static int hostDescriptor(FdEntry entry)
+    {
+        if (entry.HostFd >= 0)
+            return entry.HostFd;
+        if (entry.Stream is FileStream fs && !fs.SafeFileHandle.IsInvalid)
+            return (int) fs.SafeFileHandle.DangerousGetHandle();
+        return -1;
+    }
+
+    static void sleepUntil(ulong deadline)
+    {
+        var now = WasiClock.MonotonicNow();
+        if (deadline <= now)
+            return;
+        var delta = deadline - now;
+        if (OperatingSystem.IsWindows())
+        {
+            Thread.Sleep((int) Math.Min((delta + 999_999) / 1_000_000, int.MaxValue - 1));
+            return;
+        }
+
+        var ts = new timespec {tv_sec = (nint) (delta / 1_000_000_000), tv_nsec = (nint) (delta % 1_000_000_000)};
+        // continues with the remaining time when interrupted by a signal.
+        while (nanosleep(ref ts, out var rem) != 0 && Marshal.GetLastWin32Error() == EINTR)
+            ts = rem;
+    }
+
+    // the kernel packs epoll_event on x86-64 only.
+    static readonly int eventSize = RuntimeInformation.ProcessArchitecture == Architecture.X64 ? 12 : 16;
+    static readonly int eventDataOffset = RuntimeInformation.ProcessArchitecture == Architecture.X64 ? 4 : 8;
+
+    bool register(int hostFd)
+    {
+        if (!OperatingSystem.IsLinux())
+            return false;
+        if (registered.Contains(hostFd))
+            return true;
+        if (epollFd < 0)
+        {
+            epollFd = epoll_create1(EPOLL_CLOEXEC);
+            if (epollFd < 0)
+                return false;
+        }
+
+        Span<byte> ev = stackalloc byte[16];
+        Unsafe.As<byte, uint>(ref ev[0]) = EPOLLIN;
+        Unsafe.As<byte, int>(ref ev[eventDataOffset]) = hostFd;
+        // fails with EPERM for regular files and directories, which are always readable.
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, hostFd, ref ev[0]) != 0)
+            return false;
+        registered.Add(hostFd);
+        return true;
+    }
+
+    void unregisterUnused()
+    {
+        if (registered.IsSubsetOf(waitFds))
+            return;
+        Span<byte> ev = stackalloc byte[16];
+        foreach (var fd in registered.ToArray())
+        {
+            if (waitFds.Contains(fd)) continue;
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, ref ev[0]);
+            registered.Remove(fd);
+        }
+    }
+
+    void waitEpoll(ulong deadline)
+    {
+        readyFds.Clear();
+        Span<byte> events = stackalloc byte[16 * 16];
+        while (true)
+        {
+            int timeoutMs = -1;
+            if (deadline != ulong.MaxValue)
+            {
+                var now = WasiClock.MonotonicNow();
+                // rounded up, so a clock subscription never fires early.
+                timeoutMs = deadline <= now ? 0 : (int) Math.Min(int.MaxValue, (deadline - now + 999_999) / 1_000_000);
+            }
+
+            var n = epoll_wait(epollFd, ref events[0], events.Length / eventSize, timeoutMs);
+            if (n < 0 && Marshal.GetLastWin32Error() == EINTR)
+                continue;
+            for (int i = 0; i < n; i++)
+                readyFds.Add(Unsafe.As<byte, int>(ref events[i * eventSize + eventDataOffset]));
+            return;
+        }
+    }
+
+    public void Dispose()
+    {
+        if (epollFd >= 0)
+            close(epollFd);
+        epollFd = -1;
+        registered.Clear();
+    }
+
+    const int EINTR = 4;
+    const int EPOLL_CLOEXEC = 0x80000;
+    const int EPOLL_CTL_ADD = 1;
+    const int EPOLL_CTL_DEL = 2;
+    const uint EPOLLIN = 1;
+
+    [StructLayout(LayoutKind.Sequential)]
+    struct timespec
+    {
+        public nint tv_sec;
+        public nint tv_nsec;
+    }
+
+    [DllImport("libc", SetLastError = true)]
+    static extern int nanosleep(ref timespec req, out timespec rem);
+
+    [DllImport("libc", SetLastError = true)]
+    static extern int epoll_create1(int flags);
+
+    [DllImport("libc", SetLastError = true)]
+    static extern int epoll_ctl(int epfd, int op, int fd, ref byte ev);
+
+    [DllImport("libc", SetLastError = true)]
+    static extern int epoll_wait(int epfd, ref byte events, int maxEvents, int timeout);
+
+    [DllImport("libc")]
+    static extern int close(int fd);
+}
@@ -0,0 +1,52 @@
+using System.Security.Cryptography;
+
+namespace Wasm2Il;
+
+/// <summary>
+/// Source for random_get. Small requests are served from a pool refilled by the OS CSPRNG, so they do not
+/// each cost a system call. With a seed, the output is a deterministic (non cryptographic) sequence instead.
+/// </summary>
+public class WasiRandom
+{
+    const int poolSize = 4096;
+    const int smallRequest = 256;
+
+    readonly byte[] pool = new byte[poolSize];
+    int poolPosition = poolSize;
+    readonly Random? deterministic;
+
+    public WasiRandom(int? seed = null)
+    {
+        if (seed is { } s)
+            deterministic = new Random(s);
+    }
+
+    public bool IsDeterministic => deterministic != null;
+
+    public void Fill(Span<byte> buffer)
+    {
+        if (deterministic != null)
+        {
+            deterministic.NextBytes(buffer);
+            return;
+        }
+
+        if (buffer.Length > smallRequest)
+        {
+            RandomNumberGenerator.Fill(buffer);
+            return;
+        }
+
+        if (poolSize - poolPosition < buffer.Length)
+        {
+            RandomNumberGenerator.Fill(pool);
+            poolPosition = 0;
+        }
+
+        var chunk = pool.AsSpan(poolPosition, buffer.Length);
+        chunk.CopyTo(buffer);
+        // bytes handed out are not kept around.
+        chunk.Clear();
+        poolPosition += buffer.Length;
+    }
+}
@@ -13,5 +13,6 @@ public enum Section : byte
     START = 8,
     ELEMENT = 9,
     CODE = 10,
-    DATA = 11
+    DATA = 11,
+    DATACOUNT = 12
 }
\ No newline at end of file
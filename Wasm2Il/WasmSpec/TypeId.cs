@@ -7,5 +7,10 @@ struct TypeId
     public uint ParamCount;
     public uint ReturnCount;
     public TypeReference[] ParamTypes;
+    public TypeReference[] ReturnTypes;
+
+    /// <summary>
+    /// The CLR return type; a ValueTuple of ReturnTypes when there are several.
+    /// </summary>
     public TypeReference ReturnType;
 }
\ No newline at end of file